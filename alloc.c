@@ -0,0 +1,18 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements handling of failed allocations.
+ */
+
+#include "alloc.h"
+
+#include <setjmp.h>
+#include <stdlib.h>
+
+_Thread_local jmp_buf *allocationRecovery = NULL;
+
+_Noreturn void allocationFailed(void) {
+    if (allocationRecovery != NULL)
+        longjmp(*allocationRecovery, 1);
+    exit(1);
+}
@@ -0,0 +1,23 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides handling of failed allocations. By default the
+ *   program exits with code 1. Library functions set a recovery point of
+ *   their thread before they start work, then failed allocation returns
+ *   there, so the function can report error to the caller instead.
+ *   Memory allocated by interrupted work isn't freed.
+ */
+
+#ifndef SIMILAR_LINES_ALLOC_H
+#define SIMILAR_LINES_ALLOC_H
+
+#include <setjmp.h>
+
+// recovery point of current thread, NULL if failure ends the program
+extern _Thread_local jmp_buf *allocationRecovery;
+
+// called when memory or other resource can't be allocated, jumps to
+// recovery point of thread or exits if there is none
+_Noreturn void allocationFailed(void);
+
+#endif //SIMILAR_LINES_ALLOC_H
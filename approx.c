@@ -0,0 +1,312 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements approximate grouping. Similar lines are grouped
+ *   by hashing first, so each class is compared as one line. Multiset of
+ *   elements of class becomes set of hashes (see fingerprint.h) and its
+ *   MinHash signature is computed: for each of SIGNATURE_SIZE hash
+ *   functions the minimum of hashes of elements. Probability that two
+ *   minimums are equal is the Jaccard index of sets. Signature is split
+ *   into bands of rows, classes with equal band are candidates and they
+ *   are joined if their exact Jaccard index is high enough. Number of rows
+ *   is chosen by threshold, so similar enough pairs are likely to share a
+ *   band and dissimilar ones aren't.
+ *   Classes with equal band are put next to each other by sorting, each
+ *   class is compared only with a few next classes of the same bucket, so
+ *   large buckets don't make time quadratic. Joined classes are kept in
+ *   union-find structure, which root is the class with the smallest first
+ *   line, so groups are created in order of their first lines.
+ */
+
+#include "approx.h"
+
+#include "alloc.h"
+#include "fingerprint.h"
+#include "group.h"
+#include "line.h"
+#include "lineVector.h"
+#include "parallel.h"
+#include "sort.h"
+#include "stats.h"
+#include "vector.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+// number of minimums in signature
+#define SIGNATURE_SIZE 64
+
+// each class of bucket is compared with at most this number of next ones
+static const size_t MAX_BUCKET_COMPARISONS = 8;
+
+// classes of similar lines and their signatures
+typedef struct {
+    const Line **representatives;
+    ULLVector *elements;            // sorted hashes of elements
+    unsigned long long *bands;      // bandCount hashes of bands of class
+    size_t size;
+    int rows;                       // minimums in one band
+    int bandCount;
+} Signatures;
+
+// band of class, classes with equal keys are candidates
+typedef struct {
+    unsigned long long key;
+    size_t index;
+} BucketItem;
+
+// returns line with given number, lines have to be in input order
+static const Line *findLine(const LineVector *lv, unsigned long long nr) {
+    size_t low = 0;
+    size_t high = lv->size;
+
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+        if ((unsigned long long)lv->items[middle].nr <= nr)
+            low = middle;
+        else
+            high = middle;
+    }
+
+    return &lv->items[low];
+}
+
+// returns the largest number of rows, for which similarity
+// (1 / bands) ^ (1 / rows), at which probability of sharing a band grows
+// the fastest, isn't above threshold
+static int chooseRows(double threshold) {
+    int rows = 1;
+
+    for (int r = 2; r <= SIGNATURE_SIZE; r *= 2) {
+        double power = 1;
+        for (int i = 0; i < r; ++i) {
+            power *= threshold;
+        }
+
+        if (power * (SIGNATURE_SIZE / r) >= 1)
+            rows = r;
+    }
+
+    return rows;
+}
+
+// cheap hash function chosen by seed, input is already a good hash
+static inline unsigned long long permute(unsigned long long x,
+                                         unsigned long long seed) {
+    x = (x ^ seed) * 0x9e3779b97f4a7c15ULL;
+    return x ^ (x >> 29);
+}
+
+static void computeSignatures(size_t begin, size_t end, void *arg) {
+    Signatures *s = arg;
+    unsigned long long seeds[SIGNATURE_SIZE];
+    unsigned long long minimums[SIGNATURE_SIZE];
+
+    for (int k = 0; k < SIGNATURE_SIZE; ++k) {
+        seeds[k] = hashNumber((unsigned long long)k + 1);
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+        ULLVector *elements = &s->elements[i];
+        lineElementHashes(s->representatives[i], elements);
+        const unsigned long long *hashes = ULLVectorItems(elements);
+
+        for (int k = 0; k < SIGNATURE_SIZE; ++k) {
+            minimums[k] = ULLONG_MAX;
+        }
+        for (size_t j = 0; j < elements->size; ++j) {
+            for (int k = 0; k < SIGNATURE_SIZE; ++k) {
+                unsigned long long h = permute(hashes[j], seeds[k]);
+                if (h < minimums[k])
+                    minimums[k] = h;
+            }
+        }
+
+        unsigned long long *bands = s->bands + i * s->bandCount;
+        for (int b = 0; b < s->bandCount; ++b) {
+            unsigned long long key = 0;
+            for (int r = 0; r < s->rows; ++r) {
+                key = hashNumber(key ^ minimums[b * s->rows + r]);
+            }
+            bands[b] = key;
+        }
+    }
+}
+
+// returns 1 if Jaccard index of sorted sets is at least threshold
+static int similarEnough(const ULLVector *a, const ULLVector *b,
+                         double threshold) {
+    size_t smaller = a->size < b->size ? a->size : b->size;
+    size_t larger = a->size + b->size - smaller;
+
+    // index is at most ratio of sizes
+    if ((double)smaller < threshold * (double)larger)
+        return 0;
+
+    const unsigned long long *x = ULLVectorItems(a);
+    const unsigned long long *y = ULLVectorItems(b);
+    size_t common = 0;
+    for (size_t i = 0, j = 0; i < a->size && j < b->size;) {
+        if (x[i] < y[j]) {
+            ++i;
+        }
+        else if (x[i] > y[j]) {
+            ++j;
+        }
+        else {
+            ++common;
+            ++i;
+            ++j;
+        }
+    }
+
+    size_t all = a->size + b->size - common;
+    return all == 0 || (double)common >= threshold * (double)all;
+}
+
+static size_t findRoot(size_t *parent, size_t i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+// joins sets of classes, the smaller index becomes root
+static void join(size_t *parent, size_t a, size_t b) {
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a < b)
+        parent[b] = a;
+    else
+        parent[a] = b;
+}
+
+static int cmpBucketItems(const void *a, const void *b) {
+    const BucketItem *x = a;
+    const BucketItem *y = b;
+
+    if (x->key != y->key)
+        return x->key < y->key ? -1 : 1;
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+// joins classes which share a band and are similar enough
+static void joinCandidates(const Signatures *s, double threshold,
+                           size_t *parent) {
+    BucketItem *items = malloc(s->size * sizeof (BucketItem));
+    if (items == NULL) {
+        allocationFailed();
+    }
+
+    for (int b = 0; b < s->bandCount; ++b) {
+        for (size_t i = 0; i < s->size; ++i) {
+            BucketItem item = {s->bands[i * s->bandCount + b], i};
+            items[i] = item;
+        }
+        qsort(items, s->size, sizeof (BucketItem), cmpBucketItems);
+
+        for (size_t begin = 0, end; begin < s->size; begin = end) {
+            end = begin + 1;
+            while (end < s->size && items[end].key == items[begin].key) {
+                ++end;
+            }
+
+            for (size_t i = begin; i < end; ++i) {
+                size_t last = i + MAX_BUCKET_COMPARISONS;
+                for (size_t j = i + 1; j < end && j <= last; ++j) {
+                    size_t x = items[i].index;
+                    size_t y = items[j].index;
+
+                    if (findRoot(parent, x) != findRoot(parent, y) &&
+                        similarEnough(&s->elements[x], &s->elements[y],
+                                      threshold))
+                        join(parent, x, y);
+                }
+            }
+        }
+    }
+
+    free(items);
+}
+
+// moves lines of joined classes into groups in order of their first lines
+static void collectGroups(ULLVectorVector *classes, size_t *parent,
+                          ULLVectorVector *groups) {
+    size_t *groupOf = malloc(classes->size * sizeof (size_t));
+    char *merged = calloc(classes->size, 1);
+    if (groupOf == NULL || merged == NULL) {
+        allocationFailed();
+    }
+
+    for (size_t i = 0; i < classes->size; ++i) {
+        size_t root = findRoot(parent, i);
+
+        if (root == i) {
+            groupOf[i] = groups->size;
+            ULLVectorVectorPush(groups, classes->items[i]);
+            continue;
+        }
+
+        // root is smaller than i, so its group already exists
+        size_t g = groupOf[root];
+        const unsigned long long *lines = ULLVectorItems(&classes->items[i]);
+        for (size_t j = 0; j < classes->items[i].size; ++j) {
+            ULLVectorPush(&groups->items[g], lines[j]);
+        }
+        ULLVectorFree(&classes->items[i]);
+        merged[g] = 1;
+    }
+
+    for (size_t g = 0; g < groups->size; ++g) {
+        if (merged[g])
+            sortULLArray(ULLVectorItems(&groups->items[g]),
+                         groups->items[g].size);
+    }
+
+    free(groupOf);
+    free(merged);
+}
+
+void groupApproximately(LineVector *lv, int threads, double threshold,
+                        ULLVectorVector *groups) {
+    ULLVectorVector classes = ULLVectorVectorNew();
+    groupByHashing(lv, threads, &classes);
+
+    statsPhase("signatures");
+    Signatures s;
+    s.size = classes.size;
+    s.rows = chooseRows(threshold);
+    s.bandCount = SIGNATURE_SIZE / s.rows;
+    s.representatives = malloc(s.size * sizeof (const Line *));
+    s.elements = malloc(s.size * sizeof (ULLVector));
+    s.bands = malloc(s.size * s.bandCount * sizeof (unsigned long long));
+    size_t *parent = malloc(s.size * sizeof (size_t));
+    if (s.size > 0 && (s.representatives == NULL || s.elements == NULL ||
+                       s.bands == NULL || parent == NULL)) {
+        allocationFailed();
+    }
+
+    for (size_t i = 0; i < s.size; ++i) {
+        s.representatives[i] = findLine(lv,
+                                        ULLVectorItems(&classes.items[i])[0]);
+        s.elements[i] = ULLVectorNew();
+        parent[i] = i;
+    }
+    parallelFor(s.size, threads, computeSignatures, &s);
+
+    statsPhase("join");
+    joinCandidates(&s, threshold, parent);
+
+    statsPhase("group");
+    collectGroups(&classes, parent, groups);
+
+    for (size_t i = 0; i < s.size; ++i) {
+        ULLVectorFree(&s.elements[i]);
+    }
+    free(classes.items);
+    free(s.representatives);
+    free(s.elements);
+    free(s.bands);
+    free(parent);
+}
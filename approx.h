@@ -0,0 +1,27 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides approximate grouping of lines, which puts into one
+ *   group also lines which are almost similar. Similarity of two lines is
+ *   Jaccard index of multisets of their elements, that is number of common
+ *   elements divided by number of elements of either line. Lines with
+ *   similarity at least equal to threshold are joined, groups are closed
+ *   under this relation, so lines of one group may be connected by a chain
+ *   of such pairs.
+ *   Pairs are found with MinHash signatures and locality-sensitive hashing,
+ *   so some of them may be missed, but time is near-linear in size of input.
+ */
+
+#ifndef SIMILAR_LINES_APPROX_H
+#define SIMILAR_LINES_APPROX_H
+
+#include "lineVector.h"
+#include "vector.h"
+
+// groups lines which Jaccard index is at least threshold, groups are
+// sorted as in other modes
+// lines in lv have to be in input order
+void groupApproximately(LineVector *lv, int threads, double threshold,
+                        ULLVectorVector *groups);
+
+#endif //SIMILAR_LINES_APPROX_H
@@ -0,0 +1,110 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements arena allocator. Small allocations are cut from
+ *   current block, big ones get their own block which is put behind the
+ *   current one, so free space of current block isn't wasted.
+ */
+
+#include "arena.h"
+
+#include "alloc.h"
+#include "stats.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+const size_t ARENA_BLOCK_SIZE = 1 << 20;
+const size_t ALIGNMENT = _Alignof(max_align_t);
+
+struct ArenaBlock {
+    ArenaBlock *next;
+    max_align_t data[];
+};
+
+Arena ArenaNew() {
+    Arena obj = {NULL, NULL, 0, 0};
+    return obj;
+}
+
+void ArenaFree(Arena *self) {
+    while (self->blocks != NULL) {
+        ArenaBlock *next = self->blocks->next;
+        free(self->blocks);
+        self->blocks = next;
+    }
+    self->position = NULL;
+    self->left = 0;
+    self->allocated = 0;
+}
+
+// returns NULL if block can't be allocated
+static ArenaBlock *newBlock(size_t size) {
+    statsAllocation(ALLOCATION_ARENA, sizeof (ArenaBlock) + size);
+    return malloc(sizeof (ArenaBlock) + size);
+}
+
+void *ArenaAlloc(Arena *self, size_t size) {
+    void *result = ArenaTryAlloc(self, size);
+    if (result == NULL) {
+        allocationFailed();
+    }
+    return result;
+}
+
+void *ArenaTryAlloc(Arena *self, size_t size) {
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+    if (size <= self->left) {
+        void *result = self->position;
+        self->position += size;
+        self->left -= size;
+        return result;
+    }
+
+    if (size > ARENA_BLOCK_SIZE / 4) {
+        ArenaBlock *block = newBlock(size);
+        if (block == NULL)
+            return NULL;
+        if (self->blocks == NULL) {
+            block->next = NULL;
+            self->blocks = block;
+        } else {
+            block->next = self->blocks->next;
+            self->blocks->next = block;
+        }
+        self->allocated += size;
+        return block->data;
+    }
+
+    ArenaBlock *block = newBlock(ARENA_BLOCK_SIZE);
+    if (block == NULL)
+        return NULL;
+    block->next = self->blocks;
+    self->blocks = block;
+    self->position = (char *)block->data + size;
+    self->left = ARENA_BLOCK_SIZE - size;
+    self->allocated += ARENA_BLOCK_SIZE;
+
+    return block->data;
+}
+
+void ArenaMerge(Arena *self, Arena *other) {
+    if (other->blocks == NULL)
+        return;
+
+    if (self->blocks == NULL) {
+        *self = *other;
+    } else {
+        // blocks of other arena are put behind the current block of self
+        ArenaBlock *last = other->blocks;
+        while (last->next != NULL) {
+            last = last->next;
+        }
+        last->next = self->blocks->next;
+        self->blocks->next = other->blocks;
+        self->allocated += other->allocated;
+    }
+
+    *other = ArenaNew();
+}
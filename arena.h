@@ -0,0 +1,36 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides arena (region) allocator. Memory is taken from
+ *   large blocks and it can't be freed separately, whole arena is freed at
+ *   once.
+ */
+
+#ifndef SIMILAR_LINES_ARENA_H
+#define SIMILAR_LINES_ARENA_H
+
+#include <stdlib.h>
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock *blocks;     // list of blocks, the current one is first
+    char *position;         // first free byte of current block
+    size_t left;            // number of free bytes in current block
+    size_t allocated;       // total size of all blocks
+} Arena;
+
+Arena ArenaNew();
+void ArenaFree(Arena *self);
+
+// returns memory aligned for any type, it is valid until arena is freed
+void *ArenaAlloc(Arena *self, size_t size);
+
+// like ArenaAlloc, but returns NULL if there is no memory, arena stays
+// unchanged then
+void *ArenaTryAlloc(Arena *self, size_t size);
+
+// moves all blocks of other arena into self, other arena becomes empty
+void ArenaMerge(Arena *self, Arena *other);
+
+#endif //SIMILAR_LINES_ARENA_H
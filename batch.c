@@ -0,0 +1,372 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements batch mode. Workers take next file from shared
+ *   counter, so long files don't hold back the others. Each worker reuses
+ *   its line vector and writers for all its files, interned words are
+ *   shared by all files, so common words are added to dictionary once.
+ *   When results go to stdout, each file is formatted into memory and the
+ *   main thread writes results in list order as soon as they are ready.
+ *   Workers don't take file which is too far ahead of the first unwritten
+ *   one, so only few results wait in memory for earlier files.
+ *   Threads which are left when there are fewer files than threads are
+ *   used to process each file.
+ */
+
+#include "batch.h"
+
+#include "alloc.h"
+#include "approx.h"
+#include "group.h"
+#include "lineVector.h"
+#include "options.h"
+#include "output.h"
+#include "readInput.h"
+#include "vector.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const size_t INITIAL_FILES_SIZE = 64;
+
+// number of results which can wait for earlier files, per worker
+const size_t WAITING_PER_WORKER = 2;
+
+// result of one file kept until it's written to stdout
+typedef struct {
+    Writer groups;
+    Writer errors;
+    int failed;
+    int done;
+} Result;
+
+typedef struct {
+    const Options *options;
+    char **files;
+    size_t count;
+    size_t next;            // first file not taken by any worker
+    int failed;             // number of files which couldn't be read
+    int threads;            // number of threads used for one file
+    Result *results;        // NULL if results go to output directory
+    size_t written;         // results before it were written to stdout
+    size_t window;          // files from written on can be taken
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+    pthread_cond_t progressed;  // signalled when result was written
+} Batch;
+
+// state which worker keeps between files
+typedef struct {
+    Batch *batch;
+    LineVector lines;
+    Writer groups;          // used only with output directory
+    Writer errors;
+} Worker;
+
+// reads paths from stdin, one per line, empty lines are skipped
+static char **readManifest(size_t *count) {
+    char **files = NULL;
+    size_t allocated = 0;
+    char *path = NULL;
+    size_t size = 0;
+    ssize_t length;
+
+    *count = 0;
+    while ((length = getline(&path, &size, stdin)) != -1) {
+        if (length > 0 && path[length - 1] == '\n')
+            path[--length] = '\0';
+        if (length == 0)
+            continue;
+
+        if (*count == allocated) {
+            allocated = allocated == 0 ? INITIAL_FILES_SIZE : allocated * 2;
+            files = realloc(files, allocated * sizeof (char *));
+            if (files == NULL) {
+                allocationFailed();
+            }
+        }
+
+        files[(*count)++] = path;
+        path = NULL;
+        size = 0;
+    }
+
+    free(path);
+    return files;
+}
+
+// opens file for reading, returns -1 and prints reason if it's impossible
+static int openInput(const char *path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+
+    if (fd >= 0 && fstat(fd, &st) == 0 && S_ISDIR(st.st_mode)) {
+        close(fd);
+        errno = EISDIR;
+        fd = -1;
+    }
+    if (fd < 0)
+        perror(path);
+
+    return fd;
+}
+
+// opens file "dir/n-name.suffix" for writing, where name is base name of
+// path, returns -1 and prints reason if it's impossible
+static int openOutput(const char *dir, size_t n, const char *path,
+                      const char *suffix) {
+    const char *name = strrchr(path, '/');
+    name = name == NULL ? path : name + 1;
+
+    size_t length = strlen(dir) + strlen(name) + strlen(suffix) + 32;
+    char *outPath = malloc(length);
+    if (outPath == NULL) {
+        allocationFailed();
+    }
+    snprintf(outPath, length, "%s/%zu-%s.%s", dir, n, name, suffix);
+
+    int fd = open(outPath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+        perror(outPath);
+
+    free(outPath);
+    return fd;
+}
+
+// finds groups of similar lines of file, writes them into groups and
+// numbers of incorrect lines into errors
+static void processFile(Worker *worker, int fd, Writer *groups,
+                        Writer *errors) {
+    const Options *options = worker->batch->options;
+    int threads = worker->batch->threads;
+    ULLVectorVector answer = ULLVectorVectorNew();
+
+    // dictionary lives as long as batch, so files aren't retained
+    readInput(fd, &worker->lines, threads, 0, errors);
+
+    if (options->grouping == GROUP_BY_HASHING)
+        groupByHashing(&worker->lines, threads, &answer);
+    else if (options->grouping == GROUP_APPROXIMATELY)
+        groupApproximately(&worker->lines, threads, options->threshold,
+                           &answer);
+    else
+        groupBySorting(&worker->lines, threads, &answer);
+
+    writeGroups(groups, &answer, threads);
+
+    ULLVectorVectorFree(&answer);
+    LineVectorClear(&worker->lines);
+}
+
+// processes i-th file into output directory, returns 1 if it failed
+static int processIntoDirectory(Worker *worker, size_t i) {
+    const char *dir = worker->batch->options->outputDir;
+    const char *path = worker->batch->files[i];
+
+    int fd = openInput(path);
+    if (fd < 0)
+        return 1;
+
+    int groupsFd = openOutput(dir, i + 1, path, "out");
+    int errorsFd = groupsFd < 0 ? -1 : openOutput(dir, i + 1, path, "err");
+    if (errorsFd < 0) {
+        if (groupsFd >= 0)
+            close(groupsFd);
+        close(fd);
+        return 1;
+    }
+
+    // buffers of writers are kept, only their files are changed
+    worker->groups.fd = groupsFd;
+    worker->errors.fd = errorsFd;
+    processFile(worker, fd, &worker->groups, &worker->errors);
+    WriterFlush(&worker->groups);
+    WriterFlush(&worker->errors);
+
+    close(errorsFd);
+    close(groupsFd);
+    close(fd);
+    return 0;
+}
+
+// processes i-th file into its result, returns 1 if it failed
+static int processIntoResult(Worker *worker, size_t i) {
+    Batch *batch = worker->batch;
+    Result result = {WriterNew(-1), WriterNew(-1), 0, 1};
+
+    int fd = openInput(batch->files[i]);
+    if (fd >= 0) {
+        processFile(worker, fd, &result.groups, &result.errors);
+        close(fd);
+    }
+    else {
+        result.failed = 1;
+    }
+
+    pthread_mutex_lock(&batch->lock);
+    batch->results[i] = result;
+    pthread_cond_signal(&batch->finished);
+    pthread_mutex_unlock(&batch->lock);
+
+    return result.failed;
+}
+
+static void *work(void *arg) {
+    Worker *worker = arg;
+    Batch *batch = worker->batch;
+
+    worker->lines = LineVectorNew();
+    worker->groups = WriterNew(-1);
+    worker->errors = WriterNew(-1);
+
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        while (batch->results != NULL && batch->next < batch->count &&
+               batch->next >= batch->written + batch->window) {
+            pthread_cond_wait(&batch->progressed, &batch->lock);
+        }
+        size_t i = batch->next;
+        if (i < batch->count)
+            batch->next++;
+        pthread_mutex_unlock(&batch->lock);
+
+        if (i >= batch->count)
+            break;
+
+        int failed = batch->results == NULL
+                     ? processIntoDirectory(worker, i)
+                     : processIntoResult(worker, i);
+
+        if (failed) {
+            pthread_mutex_lock(&batch->lock);
+            batch->failed++;
+            pthread_mutex_unlock(&batch->lock);
+        }
+    }
+
+    worker->groups.fd = -1;
+    worker->errors.fd = -1;
+    WriterFree(&worker->groups);
+    WriterFree(&worker->errors);
+    LineVectorFree(&worker->lines);
+
+    return NULL;
+}
+
+// writes framed results to stdout in list order, waits for each of them
+static void printResults(Batch *batch) {
+    Writer out = WriterNew(fileno(stdout));
+
+    for (size_t i = 0; i < batch->count; ++i) {
+        pthread_mutex_lock(&batch->lock);
+        while (!batch->results[i].done) {
+            pthread_cond_wait(&batch->finished, &batch->lock);
+        }
+        pthread_mutex_unlock(&batch->lock);
+
+        Result *result = &batch->results[i];
+        const char *path = batch->files[i];
+
+        if (result->failed) {
+            WriterBytes(&out, "FAIL ", 5);
+        }
+        else {
+            WriterBytes(&out, "FILE ", 5);
+            WriterNumber(&out, result->groups.size);
+            WriterChar(&out, ' ');
+            WriterNumber(&out, result->errors.size);
+            WriterChar(&out, ' ');
+        }
+        WriterBytes(&out, path, strlen(path));
+        WriterChar(&out, '\n');
+        WriterAppend(&out, &result->groups);
+        WriterAppend(&out, &result->errors);
+        WriterFlush(&out);
+
+        WriterFree(&result->groups);
+        WriterFree(&result->errors);
+
+        pthread_mutex_lock(&batch->lock);
+        batch->written = i + 1;
+        pthread_cond_broadcast(&batch->progressed);
+        pthread_mutex_unlock(&batch->lock);
+    }
+
+    WriterFree(&out);
+}
+
+int findSimilarInFiles(const Options *options) {
+    Batch batch;
+    char **manifest = NULL;
+
+    batch.options = options;
+    batch.files = options->files;
+    batch.count = (size_t)options->fileCount;
+    batch.next = 0;
+    batch.failed = 0;
+    batch.results = NULL;
+    batch.written = 0;
+
+    if (batch.count == 0) {
+        manifest = readManifest(&batch.count);
+        batch.files = manifest;
+    }
+
+    int workers = options->threads;
+    if ((size_t)workers > batch.count)
+        workers = batch.count > 0 ? (int)batch.count : 1;
+    batch.threads = options->threads / workers;
+    batch.window = (size_t)workers * WAITING_PER_WORKER;
+
+    if (options->outputDir == NULL) {
+        batch.results = calloc(batch.count + 1, sizeof (Result));
+        if (batch.results == NULL) {
+            allocationFailed();
+        }
+    }
+
+    Worker *states = malloc(workers * sizeof (Worker));
+    pthread_t *ids = malloc(workers * sizeof (pthread_t));
+    if (states == NULL || ids == NULL) {
+        allocationFailed();
+    }
+
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_cond_init(&batch.finished, NULL);
+    pthread_cond_init(&batch.progressed, NULL);
+
+    for (int i = 0; i < workers; ++i) {
+        states[i].batch = &batch;
+        if (pthread_create(&ids[i], NULL, work, &states[i]) != 0) {
+            allocationFailed();
+        }
+    }
+
+    if (batch.results != NULL)
+        printResults(&batch);
+
+    for (int i = 0; i < workers; ++i) {
+        pthread_join(ids[i], NULL);
+    }
+
+    pthread_cond_destroy(&batch.finished);
+    pthread_cond_destroy(&batch.progressed);
+    pthread_mutex_destroy(&batch.lock);
+
+    if (manifest != NULL) {
+        for (size_t i = 0; i < batch.count; ++i) {
+            free(manifest[i]);
+        }
+        free(manifest);
+    }
+    free(batch.results);
+    free(states);
+    free(ids);
+
+    return batch.failed;
+}
@@ -0,0 +1,30 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides batch mode, which finds similar lines in each of
+ *   many files separately. Files are processed concurrently by a pool of
+ *   workers, which share interned words and keep their buffers between
+ *   files.
+ *   Result of each file is either written into output directory as
+ *   "N-NAME.out" with groups and "N-NAME.err" with numbers of incorrect
+ *   lines, where N is position of file in the list and NAME is its base
+ *   name, or into one stream on stdout, in which files are in list order
+ *   and each one is framed by header line
+ *     FILE OUT ERR PATH
+ *   followed by OUT bytes of groups and ERR bytes of numbers of incorrect
+ *   lines. File which can't be read has header line
+ *     FAIL PATH
+ *   and the reason is printed on stderr.
+ */
+
+#ifndef SIMILAR_LINES_BATCH_H
+#define SIMILAR_LINES_BATCH_H
+
+#include "options.h"
+
+// processes files given in options or, if there are none, files listed on
+// stdin one per line
+// returns number of files which couldn't be read
+int findSimilarInFiles(const Options *options);
+
+#endif //SIMILAR_LINES_BATCH_H
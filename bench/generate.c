@@ -0,0 +1,297 @@
+/**
+ * Summary of File:
+ *
+ *   This file contains generator of synthetic input for benchmarks. Output
+ *   depends only on options, so the same options give the same input on
+ *   every machine. Duplicates are earlier lines with shuffled tokens and
+ *   different whitespaces, so they are similar but not equal as text.
+ *
+ *   Options:
+ *     -n lines       number of lines (default 100000)
+ *     -t tokens      maximal number of tokens in line (default 8)
+ *     -d ratio       part of lines which are duplicates (default 0.5)
+ *     -m mix         weights of token types as list of type=weight, types
+ *                    are hex, oct, dec, neg, double and string
+ *                    (default hex=1,oct=1,dec=4,neg=1,double=1,string=2)
+ *     -v words       number of different strings (default 1000)
+ *     -c ratio       part of lines which are comments (default 0.01)
+ *     -e ratio       part of lines with illegal characters (default 0.01)
+ *     -s seed        seed of random numbers (default 1)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_TOKEN_LENGTH 32
+
+// number of earlier lines which can be duplicated
+#define HISTORY_SIZE 65536
+
+typedef enum {
+    TOKEN_HEX,
+    TOKEN_OCT,
+    TOKEN_DEC,
+    TOKEN_NEG,
+    TOKEN_DOUBLE,
+    TOKEN_STRING,
+    TOKEN_TYPES
+} tokenType;
+
+static const char *TOKEN_NAMES[TOKEN_TYPES] = {
+    "hex", "oct", "dec", "neg", "double", "string"
+};
+
+typedef struct {
+    unsigned long long lines;
+    int tokens;
+    double duplicates;
+    double weights[TOKEN_TYPES];
+    unsigned long long words;
+    double comments;
+    double errors;
+    unsigned long long seed;
+} Settings;
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s [-n lines] [-t tokens] [-d ratio] [-m mix] "
+                    "[-v words] [-c ratio] [-e ratio] [-s seed]\n", program);
+    exit(2);
+}
+
+// xorshift64*, state must not be 0
+static unsigned long long nextRandom(unsigned long long *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+// returns random number from [0, n)
+static unsigned long long randomBelow(unsigned long long *state,
+                                      unsigned long long n) {
+    return nextRandom(state) % n;
+}
+
+// returns random number from [0, 1)
+static double randomUnit(unsigned long long *state) {
+    return (double)(nextRandom(state) >> 11) / (double)(1ULL << 53);
+}
+
+static unsigned long long seedState(unsigned long long seed) {
+    unsigned long long state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    return state == 0 ? 1 : state;
+}
+
+// parses list of type=weight
+static void parseMix(const char *program, const char *mix,
+                     double weights[TOKEN_TYPES]) {
+    for (int i = 0; i < TOKEN_TYPES; ++i) {
+        weights[i] = 0;
+    }
+
+    while (*mix != '\0') {
+        size_t length = strcspn(mix, "=");
+        int type = 0;
+        while (type < TOKEN_TYPES &&
+               !(strlen(TOKEN_NAMES[type]) == length &&
+                 strncmp(TOKEN_NAMES[type], mix, length) == 0)) {
+            type++;
+        }
+        if (type == TOKEN_TYPES || mix[length] != '=')
+            usage(program);
+
+        char *end = NULL;
+        weights[type] = strtod(mix + length + 1, &end);
+        if (end == mix + length + 1 || weights[type] < 0 ||
+            (*end != ',' && *end != '\0'))
+            usage(program);
+
+        mix = *end == ',' ? end + 1 : end;
+    }
+}
+
+static Settings parseSettings(int argc, char *argv[]) {
+    Settings s = {100000, 8, 0.5, {1, 1, 4, 1, 1, 2}, 1000, 0.01, 0.01, 1};
+
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i][0] != '-' || argv[i][1] == '\0' || argv[i][2] != '\0' ||
+            i + 1 >= argc)
+            usage(argv[0]);
+
+        const char *value = argv[++i];
+        char *end = NULL;
+
+        switch (argv[i - 1][1]) {
+            case 'n':
+                s.lines = strtoull(value, &end, 10);
+                break;
+            case 't':
+                s.tokens = (int)strtol(value, &end, 10);
+                if (s.tokens < 1 || s.tokens > 1000)
+                    usage(argv[0]);
+                break;
+            case 'd':
+                s.duplicates = strtod(value, &end);
+                break;
+            case 'm':
+                parseMix(argv[0], value, s.weights);
+                end = "";
+                break;
+            case 'v':
+                s.words = strtoull(value, &end, 10);
+                if (s.words == 0)
+                    usage(argv[0]);
+                break;
+            case 'c':
+                s.comments = strtod(value, &end);
+                break;
+            case 'e':
+                s.errors = strtod(value, &end);
+                break;
+            case 's':
+                s.seed = strtoull(value, &end, 10);
+                break;
+            default:
+                usage(argv[0]);
+        }
+
+        if (end == value || *end != '\0')
+            usage(argv[0]);
+    }
+
+    double total = 0;
+    for (int i = 0; i < TOKEN_TYPES; ++i) {
+        total += s.weights[i];
+    }
+    if (!(total > 0))
+        usage(argv[0]);
+
+    return s;
+}
+
+static tokenType randomType(unsigned long long *state, const Settings *s) {
+    double total = 0;
+    for (int i = 0; i < TOKEN_TYPES; ++i) {
+        total += s->weights[i];
+    }
+
+    double x = randomUnit(state) * total;
+    for (int i = 0; i < TOKEN_TYPES - 1; ++i) {
+        if (x < s->weights[i])
+            return (tokenType)i;
+        x -= s->weights[i];
+    }
+    return TOKEN_STRING;
+}
+
+// writes word number n of vocabulary, letters are in random case
+static void writeWord(char *out, unsigned long long n,
+                      unsigned long long *state) {
+    int length = 0;
+    do {
+        char c = (char)('a' + n % 26);
+        if (randomBelow(state, 4) == 0)
+            c = (char)(c - 'a' + 'A');
+        out[length++] = c;
+        n /= 26;
+    } while (n > 0);
+    out[length++] = 'x';
+    out[length] = '\0';
+}
+
+// writes random token of given type, content depends only on state
+static void writeToken(char *out, tokenType type, unsigned long long *state,
+                       const Settings *s) {
+    unsigned long long x = nextRandom(state);
+
+    switch (type) {
+        case TOKEN_HEX:
+            if (x & 2)
+                sprintf(out, "0x%llX", x >> (x % 48));
+            else
+                sprintf(out, "0x%llx", x >> (x % 48));
+            break;
+        case TOKEN_OCT:
+            sprintf(out, "0%llo", x >> (16 + x % 48));
+            break;
+        case TOKEN_DEC:
+            sprintf(out, "%llu", x >> (x % 56));
+            break;
+        case TOKEN_NEG:
+            sprintf(out, "-%llu", (x >> (x % 56)) | 1);
+            break;
+        case TOKEN_DOUBLE:
+            sprintf(out, "%.*g", 1 + (int)(x % 17),
+                    (double)(long long)(x >> 12) / 1e6 *
+                    ((x & 1) ? -1 : 1));
+            break;
+        default:
+            writeWord(out, randomBelow(state, s->words), state);
+            break;
+    }
+}
+
+// prints line generated from its seed, tokens are shuffled by state
+static void printLine(unsigned long long lineSeed, unsigned long long *state,
+                      const Settings *s) {
+    static char tokens[1000][MAX_TOKEN_LENGTH];
+    unsigned long long content = seedState(lineSeed);
+    int n = 1 + (int)randomBelow(&content, (unsigned long long)s->tokens);
+
+    for (int i = 0; i < n; ++i) {
+        writeToken(tokens[i], randomType(&content, s), &content, s);
+    }
+
+    for (int i = n - 1; i > 0; --i) {
+        int j = (int)randomBelow(state, (unsigned long long)i + 1);
+        char tmp[MAX_TOKEN_LENGTH];
+        memcpy(tmp, tokens[i], MAX_TOKEN_LENGTH);
+        memcpy(tokens[i], tokens[j], MAX_TOKEN_LENGTH);
+        memcpy(tokens[j], tmp, MAX_TOKEN_LENGTH);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        if (i > 0)
+            fputs(randomBelow(state, 8) == 0 ? "\t " : " ", stdout);
+        fputs(tokens[i], stdout);
+    }
+    putchar('\n');
+}
+
+int main(int argc, char *argv[]) {
+    Settings s = parseSettings(argc, argv);
+    unsigned long long state = seedState(s.seed);
+    unsigned long long *history = malloc(HISTORY_SIZE *
+                                         sizeof (unsigned long long));
+    if (history == NULL) {
+        exit(1);
+    }
+    unsigned long long historySize = 0;
+
+    for (unsigned long long i = 0; i < s.lines; ++i) {
+        double kind = randomUnit(&state);
+
+        if (kind < s.comments) {
+            printf("# comment %llu\n", nextRandom(&state));
+        }
+        else if (kind < s.comments + s.errors) {
+            printf("%llu \x01 %llu\n", nextRandom(&state),
+                   nextRandom(&state));
+        }
+        else if (historySize > 0 && randomUnit(&state) < s.duplicates) {
+            unsigned long long n = historySize < HISTORY_SIZE ? historySize
+                                                              : HISTORY_SIZE;
+            printLine(history[randomBelow(&state, n)], &state, &s);
+        }
+        else {
+            unsigned long long lineSeed = nextRandom(&state);
+            history[historySize++ % HISTORY_SIZE] = lineSeed;
+            printLine(lineSeed, &state, &s);
+        }
+    }
+
+    free(history);
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+#!/bin/bash
+#
+# Summary of File:
+#
+#   Benchmark driver. Generates inputs with bench/generate, runs program on
+#   each of them with every grouping mode and number of threads, takes the
+#   best of several runs and writes results as JSON. One more run with
+#   option --stats gives time of phases and peak memory.
+#
+#   Environment variables:
+#     PROGRAM   tested program (default ./similar_lines)
+#     LINES     number of lines of each input (default 1000000)
+#     THREADS   numbers of threads (default "1 2 4")
+#     MODES     sort, hash, approx and stream (default
+#               "sort hash approx stream"), approx uses -J 0.8
+#     REPEAT    runs of each case, the best one is reported (default 3)
+#     OUT       file with results (default bench/results.json)
+
+set -e
+
+bench_dir=$(dirname "$0")
+program=${PROGRAM:-./similar_lines}
+lines=${LINES:-1000000}
+threads_list=${THREADS:-1 2 4}
+modes=${MODES:-sort hash approx stream}
+repeat=${REPEAT:-3}
+out=${OUT:-$bench_dir/results.json}
+
+# name and options of generator for each input
+workloads=(
+    "mixed|"
+    "numbers|-m dec=4,neg=1,hex=1,oct=1,double=2"
+    "strings|-m string=1 -v 100000"
+    "unique|-d 0"
+    "long_lines|-t 200 -d 0.2"
+)
+
+tmp_dir=$(mktemp -d)
+trap 'rm -rf "$tmp_dir"' EXIT
+
+# prints current time in nanoseconds
+now() {
+    date +%s%N
+}
+
+# prints wall time in seconds of the best of $repeat runs of program with
+# given arguments on given input
+measure() {
+    local input=$1
+    shift
+    local best=""
+
+    for ((r = 0; r < repeat; r++)); do
+        local start end
+        start=$(now)
+        "$program" "$@" < "$input" > /dev/null 2> /dev/null
+        end=$(now)
+        if [ -z "$best" ] || [ $((end - start)) -lt "$best" ]; then
+            best=$((end - start))
+        fi
+    done
+
+    awk -v ns="$best" 'BEGIN { printf "%.6f", ns / 1e9 }'
+}
+
+# prints JSON fields with phases and peak memory from statistics of program
+# run with given arguments on given input
+phases() {
+    local input=$1
+    shift
+
+    "$program" --stats="$tmp_dir/stats" "$@" < "$input" > /dev/null \
+        2> /dev/null
+    awk '
+        $1 == "phase" {
+            phases = phases (phases == "" ? "" : ", ")
+            phases = phases sprintf("\"%s\": {\"wall_seconds\": %s, " \
+                                    "\"cpu_seconds\": %s}", $2, $4, $6)
+        }
+        $1 == "peak_rss_kib" { rss = $2 }
+        END { printf "\"phases\": {%s}, \"peak_rss_kib\": %d", phases, rss }
+    ' "$tmp_dir/stats"
+}
+
+results=()
+
+for workload in "${workloads[@]}"; do
+    name=${workload%%|*}
+    options=${workload#*|}
+    input="$tmp_dir/$name.in"
+
+    # shellcheck disable=SC2086
+    "$bench_dir/generate" -n "$lines" $options > "$input"
+    bytes=$(wc -c < "$input")
+
+    for mode in $modes; do
+        for threads in $threads_list; do
+            case $mode in
+                sort) args=(-g sort -j "$threads") ;;
+                hash) args=(-g hash -j "$threads") ;;
+                # threshold is fixed, so results are comparable
+                approx) args=(-g approx -J 0.8 -j "$threads") ;;
+                stream)
+                    # streaming mode works on one thread
+                    [ "$threads" = "$(set -- $threads_list; echo "$1")" ] \
+                        || continue
+                    args=(-s) ;;
+                *) echo "unknown mode $mode" >&2; exit 2 ;;
+            esac
+
+            seconds=$(measure "$input" "${args[@]}")
+            details=$(phases "$input" "${args[@]}")
+            result=$(awk -v name="$name" -v mode="$mode" -v t="$threads" \
+                         -v lines="$lines" -v bytes="$bytes" -v s="$seconds" \
+                         -v details="$details" \
+                'BEGIN {
+                    printf "{\"workload\": \"%s\", \"mode\": \"%s\", ", name, mode
+                    printf "\"threads\": %d, \"lines\": %d, \"bytes\": %d, ", t, lines, bytes
+                    printf "\"wall_seconds\": %s, ", s
+                    printf "\"mb_per_second\": %.3f, ", (s > 0 ? bytes / 1e6 / s : 0)
+                    printf "\"lines_per_second\": %.0f, ", (s > 0 ? lines / s : 0)
+                    printf "%s}", details
+                }')
+            results+=("$result")
+            echo "$name $mode -j $threads: ${seconds}s" >&2
+        done
+    done
+done
+
+commit=$(git -C "$bench_dir" rev-parse --short HEAD 2> /dev/null || echo unknown)
+
+{
+    echo "{"
+    echo "  \"commit\": \"$commit\","
+    echo "  \"date\": \"$(date -u +%Y-%m-%dT%H:%M:%SZ)\","
+    echo "  \"cpus\": $(nproc),"
+    echo "  \"results\": ["
+    for ((i = 0; i < ${#results[@]}; i++)); do
+        separator=","
+        [ $i -eq $((${#results[@]} - 1)) ] && separator=""
+        echo "    ${results[$i]}$separator"
+    done
+    echo "  ]"
+    echo "}"
+} > "$out"
+
+echo "results written to $out" >&2
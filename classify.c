@@ -0,0 +1,268 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements classification of input described in related
+ *   header. Block is processed in chunks of 64 bytes, each chunk is turned
+ *   into bit masks of whitespaces, newlines and illegal characters, one bit
+ *   per byte. Beginnings and ends of tokens are the bits where mask of
+ *   whitespaces changes, so they are found without looking at bytes again.
+ *   Chunk is written back only if it contained uppercase letters, so pages
+ *   of mapped file without them are not copied.
+ */
+
+#include "classify.h"
+
+#include "alloc.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CLASSIFY_AVX2
+#endif
+
+#define CHUNK_SIZE 64
+
+// chunk produces at most two items per byte
+static const size_t MAX_ITEMS_PER_CHUNK = 2 * CHUNK_SIZE;
+
+static const int INITIAL_INDEX_SIZE = 1024;
+
+// bit i of each mask describes byte i of chunk
+typedef struct {
+    unsigned long long space;
+    unsigned long long newLine;
+    unsigned long long illegal;
+} Masks;
+
+// lowercases chunk of CHUNK_SIZE bytes and computes its masks
+typedef void (*classifyChunk)(char *chunk, Masks *masks);
+
+StructuralIndex StructuralIndexNew(void) {
+    StructuralIndex obj = {NULL, 0, 0};
+    return obj;
+}
+
+void StructuralIndexFree(StructuralIndex *self) {
+    free(self->items);
+}
+
+// makes room for n more items
+static void reserve(StructuralIndex *self, size_t n) {
+    if (self->size + n <= self->allocated)
+        return;
+
+    size_t allocated = self->allocated == 0 ? INITIAL_INDEX_SIZE
+                                            : self->allocated * 2;
+    while (allocated < self->size + n) {
+        allocated *= 2;
+    }
+
+    size_t *items = realloc(self->items, allocated * sizeof (size_t));
+    if (items == NULL) {
+        allocationFailed();
+    }
+    self->items = items;
+    self->allocated = allocated;
+}
+
+static void classifyScalar(char *chunk, Masks *masks) {
+    Masks m = {0, 0, 0};
+
+    for (int i = 0; i < CHUNK_SIZE; ++i) {
+        unsigned char c = (unsigned char)chunk[i];
+        unsigned long long bit = 1ULL << i;
+
+        if (c == ' ' || (c >= '\t' && c <= '\r'))
+            m.space |= bit;
+        else if (c < 33 || c > 126)
+            m.illegal |= bit;
+        else if (c >= 'A' && c <= 'Z')
+            chunk[i] = (char)(c - 'A' + 'a');
+
+        if (c == '\n')
+            m.newLine |= bit;
+    }
+
+    *masks = m;
+}
+
+#if defined(__SSE2__)
+// unsigned comparisons are done as x - low <= high - low, where x <= y
+// is min(x, y) == x
+static void classifySSE2(char *chunk, Masks *masks) {
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i controlRange = _mm_set1_epi8('\r' - '\t');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i newLine = _mm_set1_epi8('\n');
+    const __m128i visibleLow = _mm_set1_epi8(33);
+    const __m128i visibleRange = _mm_set1_epi8(126 - 33);
+    const __m128i upperLow = _mm_set1_epi8('A');
+    const __m128i upperRange = _mm_set1_epi8('Z' - 'A');
+    const __m128i caseBit = _mm_set1_epi8('a' - 'A');
+    Masks m = {0, 0, 0};
+
+    for (int i = 0; i < CHUNK_SIZE; i += 16) {
+        __m128i *p = (__m128i *)(chunk + i);
+        __m128i c = _mm_loadu_si128(p);
+
+        __m128i control = _mm_sub_epi8(c, tab);
+        __m128i isSpace = _mm_or_si128(
+            _mm_cmpeq_epi8(c, space),
+            _mm_cmpeq_epi8(_mm_min_epu8(control, controlRange), control));
+        __m128i visible = _mm_sub_epi8(c, visibleLow);
+        __m128i isVisible = _mm_cmpeq_epi8(
+            _mm_min_epu8(visible, visibleRange), visible);
+        __m128i letter = _mm_sub_epi8(c, upperLow);
+        __m128i isUpper = _mm_cmpeq_epi8(
+            _mm_min_epu8(letter, upperRange), letter);
+
+        if (_mm_movemask_epi8(isUpper) != 0)
+            _mm_storeu_si128(p, _mm_or_si128(c, _mm_and_si128(isUpper,
+                                                               caseBit)));
+
+        unsigned long long legal = (unsigned)_mm_movemask_epi8(
+            _mm_or_si128(isSpace, isVisible));
+        m.space |= (unsigned long long)(unsigned)_mm_movemask_epi8(isSpace)
+            << i;
+        m.newLine |= (unsigned long long)(unsigned)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(c, newLine)) << i;
+        m.illegal |= (~legal & 0xFFFF) << i;
+    }
+
+    *masks = m;
+}
+#endif
+
+#if defined(CLASSIFY_AVX2)
+__attribute__((target("avx2")))
+static void classifyAVX2(char *chunk, Masks *masks) {
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i controlRange = _mm256_set1_epi8('\r' - '\t');
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i newLine = _mm256_set1_epi8('\n');
+    const __m256i visibleLow = _mm256_set1_epi8(33);
+    const __m256i visibleRange = _mm256_set1_epi8(126 - 33);
+    const __m256i upperLow = _mm256_set1_epi8('A');
+    const __m256i upperRange = _mm256_set1_epi8('Z' - 'A');
+    const __m256i caseBit = _mm256_set1_epi8('a' - 'A');
+    Masks m = {0, 0, 0};
+
+    for (int i = 0; i < CHUNK_SIZE; i += 32) {
+        __m256i *p = (__m256i *)(chunk + i);
+        __m256i c = _mm256_loadu_si256(p);
+
+        __m256i control = _mm256_sub_epi8(c, tab);
+        __m256i isSpace = _mm256_or_si256(
+            _mm256_cmpeq_epi8(c, space),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(control, controlRange),
+                              control));
+        __m256i visible = _mm256_sub_epi8(c, visibleLow);
+        __m256i isVisible = _mm256_cmpeq_epi8(
+            _mm256_min_epu8(visible, visibleRange), visible);
+        __m256i letter = _mm256_sub_epi8(c, upperLow);
+        __m256i isUpper = _mm256_cmpeq_epi8(
+            _mm256_min_epu8(letter, upperRange), letter);
+
+        if (_mm256_movemask_epi8(isUpper) != 0)
+            _mm256_storeu_si256(p, _mm256_or_si256(
+                c, _mm256_and_si256(isUpper, caseBit)));
+
+        unsigned long long legal = (unsigned)_mm256_movemask_epi8(
+            _mm256_or_si256(isSpace, isVisible));
+        m.space |= (unsigned long long)(unsigned)_mm256_movemask_epi8(
+            isSpace) << i;
+        m.newLine |= (unsigned long long)(unsigned)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(c, newLine)) << i;
+        m.illegal |= (~legal & 0xFFFFFFFF) << i;
+    }
+
+    *masks = m;
+}
+#endif
+
+static classifyChunk kernel = classifyScalar;
+static pthread_once_t kernelChosen = PTHREAD_ONCE_INIT;
+
+// chooses the widest instructions supported by processor
+static void chooseKernel(void) {
+#if defined(__SSE2__)
+    kernel = classifySSE2;
+#endif
+#if defined(CLASSIFY_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        kernel = classifyAVX2;
+#endif
+}
+
+static inline void push(StructuralIndex *index, size_t offset,
+                        structuralKind kind) {
+    index->items[index->size++] = offset << 2 | kind;
+}
+
+// writes items of chunk which begins at given offset of block
+// inSpace is set if the byte before chunk is whitespace
+static void indexChunk(const Masks *m, size_t offset, int *inSpace,
+                       StructuralIndex *index) {
+    unsigned long long previous = (m->space << 1) | (unsigned)*inSpace;
+    unsigned long long begins = ~m->space & previous;
+    unsigned long long ends = m->space & ~previous;
+    unsigned long long all = begins | ends | m->newLine | m->illegal;
+
+    *inSpace = (int)(m->space >> (CHUNK_SIZE - 1));
+
+    // token ends at '\n' before the line ends, illegal char may begin token
+    while (all != 0) {
+        int i = __builtin_ctzll(all);
+        unsigned long long bit = all & -all;
+
+        if (ends & bit)
+            push(index, offset + i, TOKEN_END);
+        if (m->newLine & bit)
+            push(index, offset + i, LINE_END);
+        if (begins & bit)
+            push(index, offset + i, TOKEN_BEGIN);
+        if (m->illegal & bit)
+            push(index, offset + i, ILLEGAL_CHAR);
+
+        all ^= bit;
+    }
+}
+
+void classifyBlock(char *block, size_t length, StructuralIndex *index) {
+    pthread_once(&kernelChosen, chooseKernel);
+
+    Masks masks;
+    int inSpace = 1;
+    size_t i = 0;
+
+    index->size = 0;
+
+    for (; i + CHUNK_SIZE <= length; i += CHUNK_SIZE) {
+        reserve(index, MAX_ITEMS_PER_CHUNK);
+        kernel(block + i, &masks);
+        indexChunk(&masks, i, &inSpace, index);
+    }
+
+    // the rest is padded with spaces, which end the last token
+    char rest[CHUNK_SIZE];
+    size_t restLength = length - i;
+    if (restLength > 0)
+        memcpy(rest, block + i, restLength);
+    memset(rest + restLength, ' ', CHUNK_SIZE - restLength);
+
+    reserve(index, MAX_ITEMS_PER_CHUNK + 1);
+    kernel(rest, &masks);
+    indexChunk(&masks, i, &inSpace, index);
+    if (restLength > 0 && memcmp(block + i, rest, restLength) != 0)
+        memcpy(block + i, rest, restLength);
+
+    if (length > 0 && block[length - 1] != '\n')
+        push(index, length, LINE_END);
+}
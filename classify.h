@@ -0,0 +1,48 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides classification of input bytes. One pass over a
+ *   block finds whitespaces, newlines and illegal characters, lowercases
+ *   the block in place and writes structural index of the block: offsets
+ *   of beginnings and ends of tokens, ends of lines and illegal characters
+ *   in the order of their position. Parser walks this index instead of
+ *   bytes of input.
+ *   Block is classified by AVX2 or SSE2 instructions if processor supports
+ *   them, otherwise by portable code, results are the same.
+ */
+
+#ifndef SIMILAR_LINES_CLASSIFY_H
+#define SIMILAR_LINES_CLASSIFY_H
+
+#include <stdlib.h>
+
+typedef enum {
+    TOKEN_BEGIN,        // offset of the first char of token
+    TOKEN_END,          // offset of the char after token
+    LINE_END,           // offset of '\n' or of the end of block
+    ILLEGAL_CHAR        // offset of char which is neither space nor visible
+} structuralKind;
+
+// each item is offset shifted left by two bits with kind in the lowest bits
+typedef struct {
+    size_t *items;
+    size_t size;
+    size_t allocated;
+} StructuralIndex;
+
+StructuralIndex StructuralIndexNew(void);
+void StructuralIndexFree(StructuralIndex *self);
+
+static inline size_t StructuralOffset(size_t item) {
+    return item >> 2;
+}
+
+static inline structuralKind StructuralKind(size_t item) {
+    return (structuralKind)(item & 3);
+}
+
+// lowercases block in place and replaces contents of index with structural
+// index of the block, the last line of block is ended even without '\n'
+void classifyBlock(char *block, size_t length, StructuralIndex *index);
+
+#endif //SIMILAR_LINES_CLASSIFY_H
@@ -1,207 +1,445 @@
-/**
- * Author:  Mateusz Malinowski
- * Date:    March 2021
- *
- * Summary of File:
- *
- *   This file implements functions to compare lines and sort line vector and
- *   vector of unsigned long long vectors and their auxiliary functions.
- *   To compare lines, their elements are sorted.
- *   To sorting is used qsort algorithm from standard library.
- */
-
-#include "compare.h"
-
-#include "line.h"
-#include "lineVector.h"
-#include "vector.h"
-
-#include <stdlib.h>
-#include <string.h>
-
-static int cmpULL(const void* a, const void* b)
-{
-    unsigned long long arg1 = *(const unsigned long long *)a;
-    unsigned long long arg2 = *(const unsigned long long *)b;
-
-    if (arg1 > arg2) return 1;
-    if (arg1 < arg2) return -1;
-    return 0;
-}
-
-static int cmpLL(const void* a, const void* b)
-{
-    long long arg1 = *(const long long *)a;
-    long long arg2 = *(const long long *)b;
-
-    if (arg1 > arg2) return 1;
-    if (arg1 < arg2) return -1;
-    return 0;
-}
-
-static int cmpD(const void* a, const void* b)
-{
-    double arg1 = *(const double *)a;
-    double arg2 = *(const double *)b;
-
-    if (arg1 > arg2) return 1;
-    if (arg1 < arg2) return -1;
-    return 0;
-}
-
-static int cmpS(const void* a, const void* b)
-{
-    const char *arg1 = *(const char **)a;
-    const char *arg2 = *(const char **)b;
-
-    return strcmp(arg1, arg2);
-}
-
-// sorts each component vector of given line
-static void sortElementsOfLine(const Line *line) {
-    qsort(line->ullv.items, line->ullv.size, sizeof (unsigned long long),
-        cmpULL);
-    qsort(line->llv.items, line->llv.size, sizeof (long long), cmpLL);
-    qsort(line->dv.items, line->dv.size, sizeof (double), cmpD);
-    qsort(line->sv.items, line->sv.size, sizeof (char *), cmpS);
-}
-
-static inline size_t min(size_t a, size_t b) {
-    return a < b ? a : b;
-}
-
-static int cmpULLVector(const void* a, const void* b)
-{
-    ULLVector *v1 = (ULLVector *)a;
-    ULLVector *v2 = (ULLVector *)b;
-
-    size_t end = min(v1->size, v2->size);
-
-    for (size_t i = 0; i < end; ++i) {
-        if (v1->items[i] > v2->items[i]) return 1;
-        if (v1->items[i] < v2->items[i]) return -1;
-    }
-
-    if (v1->size > v2->size) return 1;
-    if (v1->size < v2->size) return -1;
-    return 0;
-}
-
-static int cmpLLVector(const void* a, const void* b)
-{
-    LLVector *v1 = (LLVector *)a;
-    LLVector *v2 = (LLVector *)b;
-
-    size_t end = min(v1->size, v2->size);
-
-    for (size_t i = 0; i < end; ++i) {
-        if (v1->items[i] > v2->items[i]) return 1;
-        if (v1->items[i] < v2->items[i]) return -1;
-    }
-
-    if (v1->size > v2->size) return 1;
-    if (v1->size < v2->size) return -1;
-    return 0;
-}
-
-static int cmpDVector(const void* a, const void* b)
-{
-    DVector *v1 = (DVector *)a;
-    DVector *v2 = (DVector *)b;
-
-    size_t end = min(v1->size, v2->size);
-
-    for (size_t i = 0; i < end; ++i) {
-        if (v1->items[i] > v2->items[i]) return 1;
-        if (v1->items[i] < v2->items[i]) return -1;
-    }
-
-    if (v1->size > v2->size) return 1;
-    if (v1->size < v2->size) return -1;
-    return 0;
-}
-
-// compare string's arrays size n
-static int cmpStringsArray(char **v1, char **v2, size_t n) {
-    int res = 0;
-
-    for (size_t i = 0; i < n && res == 0; ++i) {
-        res = strcmp(*v1++, *v2++);
-    }
-
-    return res;
-}
-
-static int cmpSVector(const void* a, const void* b)
-{
-    SVector v1 = *(SVector *)a;
-    SVector v2 = *(SVector *)b;
-
-    int res = cmpStringsArray(v1.items, v2.items, min(v1.size, v2.size));
-
-    if (res == 0) {
-        if (v1.size > v2.size) return 1;
-        if (v1.size < v2.size) return -1;
-        return 0;
-    }
-
-    return res;
-}
-
-// compares sorted lines
-// if lines are similar, greater is line with greater number
-static int cmpLine(const void* a, const void* b)
-{
-    Line line1 = *(Line *)a;
-    Line line2 = *(Line *)b;
-
-    int res = 0;
-
-    res = cmpULLVector(&line1.ullv, &line2.ullv);
-    if (res != 0) return res;
-
-    res = cmpLLVector(&line1.llv, &line2.llv);
-    if (res != 0) return res;
-
-    res = cmpDVector(&line1.dv, &line2.dv);
-    if (res != 0) return res;
-
-    res = cmpSVector(&line1.sv, &line2.sv);
-    if (res != 0) return res;
-
-    if (line1.nr > line2.nr) return 1;
-    if (line1.nr < line2.nr) return -1;
-    return 0;
-}
-
-// sorts elements of each line in order to be able to compare, then sorts lines
-void sortLineVector(LineVector *lv) {
-    for (size_t i = 0; i < lv->size; ++i) {
-        sortElementsOfLine(&lv->items[i]);
-    }
-
-    qsort(lv->items, lv->size, sizeof (Line), cmpLine);
-}
-
-void sortULLVectorVector(ULLVectorVector *v) {
-    qsort(v->items, v->size, sizeof (ULLVector), cmpULLVector);
-}
-
-int isSimilar(const Line* a, const Line* b)
-{
-    int res = 0;
-
-    res = cmpULLVector(&a->ullv, &b->ullv);
-    if (res != 0) return res;
-
-    res = cmpLLVector(&a->llv, &b->llv);
-    if (res != 0) return res;
-
-    res = cmpDVector(&a->dv, &b->dv);
-    if (res != 0) return res;
-
-    res = cmpSVector(&a->sv, &b->sv);
-    if (res != 0) return res;
-
-    return 0;
-}
\ No newline at end of file
+/**
+ * Author:  Mateusz Malinowski
+ * Date:    March 2021
+ *
+ * Summary of File:
+ *
+ *   This file implements functions to compare lines and sort line vector and
+ *   vector of unsigned long long vectors and their auxiliary functions.
+ *   To compare lines, their elements are sorted by functions from sort.h and
+ *   lines are turned into keys (see line.h), so lines are compared by memcmp.
+ *   Lines are sorted as pointers by merge sort: runs sorted by qsort on
+ *   separate threads are merged in rounds, each merge is split into parts
+ *   at ranks found by binary search, so it is also done in parallel. Order
+ *   of lines is the same as with one qsort, because line numbers break ties.
+ *   Then lines are moved into sorted order in place by following cycles of
+ *   the permutation, so no second array of lines is needed.
+ *   Content keys contain words themselves instead of their ids, so they stay
+ *   valid after dictionary is cleared.
+ */
+
+#include "compare.h"
+
+#include "alloc.h"
+#include "arena.h"
+#include "intern.h"
+#include "line.h"
+#include "lineVector.h"
+#include "parallel.h"
+#include "sort.h"
+#include "stats.h"
+#include "vector.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// minimal number of lines for which sorting is split between threads
+const size_t MIN_PARALLEL_SORT = 1 << 14;
+
+// vectors are sorted by buckets if range of their first elements is at
+// most this many times bigger than number of vectors
+const unsigned long long MAX_BUCKETS_PER_VECTOR = 8;
+
+void sortElementsOfLine(Line *line) {
+    sortULLArray(ULLVectorItems(&line->ullv), line->ullv.size);
+    sortLLArray(LLVectorItems(&line->llv), line->llv.size);
+    sortDArray(DVectorItems(&line->dv), line->dv.size);
+    sortUIntArray(SVectorItems(&line->sv), line->sv.size);
+}
+
+static inline size_t min(size_t a, size_t b) {
+    return a < b ? a : b;
+}
+
+static int cmpULLVector(const void* a, const void* b)
+{
+    ULLVector *v1 = (ULLVector *)a;
+    ULLVector *v2 = (ULLVector *)b;
+    const unsigned long long *items1 = ULLVectorItems(v1);
+    const unsigned long long *items2 = ULLVectorItems(v2);
+
+    size_t end = min(v1->size, v2->size);
+
+    for (size_t i = 0; i < end; ++i) {
+        if (items1[i] > items2[i]) return 1;
+        if (items1[i] < items2[i]) return -1;
+    }
+
+    if (v1->size > v2->size) return 1;
+    if (v1->size < v2->size) return -1;
+    return 0;
+}
+
+// compares keys of lines, most of lines differ on first 8 bytes, so they are
+// compared without reading keys
+static int cmpKey(const Line *a, const Line *b)
+{
+    if (a->keyPrefix > b->keyPrefix) return 1;
+    if (a->keyPrefix < b->keyPrefix) return -1;
+
+    int res = memcmp(a->key, b->key, min(a->keyLength, b->keyLength));
+    if (res != 0) return res;
+
+    if (a->keyLength > b->keyLength) return 1;
+    if (a->keyLength < b->keyLength) return -1;
+    return 0;
+}
+
+// compares lines by keys
+// if lines are similar, greater is line with greater number
+static int cmpLine(const Line *a, const Line *b)
+{
+    int res = cmpKey(a, b);
+    if (res != 0) return res;
+
+    if (a->nr > b->nr) return 1;
+    if (a->nr < b->nr) return -1;
+    return 0;
+}
+
+static int cmpLinePointer(const void* a, const void* b)
+{
+    return cmpLine(*(const Line * const *)a, *(const Line * const *)b);
+}
+
+// sorted runs of pointers to lines, run i is items[bounds[i], bounds[i + 1])
+typedef struct {
+    Line **items;
+    size_t *bounds;
+} Runs;
+
+static void sortRuns(size_t begin, size_t end, void *arg) {
+    Runs *runs = arg;
+
+    for (size_t i = begin; i < end; ++i) {
+        qsort(runs->items + runs->bounds[i],
+              runs->bounds[i + 1] - runs->bounds[i], sizeof (Line *),
+              cmpLinePointer);
+    }
+}
+
+// part of merging two sorted runs, which gives out[begin, end) of merged run
+typedef struct {
+    Line **a;
+    size_t aSize;
+    Line **b;
+    size_t bSize;
+    Line **out;
+    size_t begin;
+    size_t end;
+} MergePart;
+
+// returns how many of first k elements of merged run come from run a
+static size_t coRank(size_t k, Line **a, size_t aSize, Line **b,
+                     size_t bSize) {
+    size_t low = k > bSize ? k - bSize : 0;
+    size_t high = min(k, aSize);
+
+    while (low < high) {
+        size_t i = low + (high - low) / 2;
+        size_t j = k - i;
+        if (cmpLine(a[i], b[j - 1]) < 0)
+            low = i + 1;
+        else
+            high = i;
+    }
+
+    return low;
+}
+
+static void mergeParts(size_t begin, size_t end, void *arg) {
+    MergePart *parts = arg;
+
+    for (size_t p = begin; p < end; ++p) {
+        MergePart *m = &parts[p];
+        size_t i = coRank(m->begin, m->a, m->aSize, m->b, m->bSize);
+        size_t iEnd = coRank(m->end, m->a, m->aSize, m->b, m->bSize);
+        size_t j = m->begin - i;
+        size_t jEnd = m->end - iEnd;
+        Line **out = m->out + m->begin;
+
+        while (i < iEnd && j < jEnd) {
+            *out++ = cmpLine(m->a[i], m->b[j]) < 0 ? m->a[i++] : m->b[j++];
+        }
+        while (i < iEnd) {
+            *out++ = m->a[i++];
+        }
+        while (j < jEnd) {
+            *out++ = m->b[j++];
+        }
+    }
+}
+
+// merges pairs of neighbouring runs from src into dst, each merge is split
+// into parts of similar size, so all threads have work till the last round
+// returns number of runs after merging
+static size_t mergeRuns(Line **src, Line **dst, size_t *bounds, size_t count,
+                        size_t n, int threads, MergePart *parts) {
+    size_t partCount = 0;
+    size_t newCount = 0;
+
+    for (size_t r = 0; r < count; r += 2) {
+        size_t begin = bounds[r];
+        size_t middle = bounds[min(r + 1, count)];
+        size_t end = bounds[min(r + 2, count)];
+        size_t pieces = (size_t)threads * (end - begin) / n;
+        if (pieces == 0)
+            pieces = 1;
+
+        for (size_t p = 0; p < pieces; ++p) {
+            MergePart part = {src + begin, middle - begin, src + middle,
+                              end - middle, dst + begin,
+                              (end - begin) * p / pieces,
+                              (end - begin) * (p + 1) / pieces};
+            parts[partCount++] = part;
+        }
+
+        bounds[newCount++] = begin;
+    }
+    bounds[newCount] = n;
+
+    parallelFor(partCount, threads, mergeParts, parts);
+
+    return newCount;
+}
+
+// sorts lines by merge sort of pointers, first threads sort separate runs
+// with qsort, then runs are merged in rounds
+static Line **sortLinePointers(LineVector *lv, int threads) {
+    size_t n = lv->size;
+    size_t count = n < MIN_PARALLEL_SORT ? 1 : (size_t)threads;
+    Line **items = malloc(n * sizeof (Line *));
+    Line **buffer = malloc(n * sizeof (Line *));
+    size_t *bounds = malloc((count + 1) * sizeof (size_t));
+    MergePart *parts = malloc((count + (size_t)threads) * sizeof (MergePart));
+    if (items == NULL || buffer == NULL || bounds == NULL || parts == NULL) {
+        allocationFailed();
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        items[i] = &lv->items[i];
+    }
+    for (size_t i = 0; i <= count; ++i) {
+        bounds[i] = n * i / count;
+    }
+
+    Runs runs = {items, bounds};
+    parallelFor(count, threads, sortRuns, &runs);
+
+    while (count > 1) {
+        count = mergeRuns(items, buffer, bounds, count, n, threads, parts);
+        Line **tmp = items;
+        items = buffer;
+        buffer = tmp;
+    }
+
+    free(buffer);
+    free(bounds);
+    free(parts);
+
+    return items;
+}
+
+// moves lines into given order in place, order[i] points to line which
+// goes to place i, order is overwritten
+static void permuteLines(Line *items, Line **order, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (order[i] == &items[i])
+            continue;
+
+        // each moved line leaves its place to the next line of cycle, moved
+        // places point to themselves
+        Line first = items[i];
+        size_t j = i;
+        while (1) {
+            size_t next = (size_t)(order[j] - items);
+            order[j] = &items[j];
+            if (next == i) {
+                items[j] = first;
+                break;
+            }
+            items[j] = items[next];
+            j = next;
+        }
+    }
+}
+
+// keys of lines and their place
+typedef struct {
+    LineVector *lv;
+    unsigned char *keys;
+    size_t *offsets;
+} Keys;
+
+static void writeKeys(size_t begin, size_t end, void *arg) {
+    Keys *keys = arg;
+
+    for (size_t i = begin; i < end; ++i) {
+        Line *line = &keys->lv->items[i];
+        sortElementsOfLine(line);
+        LineWriteKey(line, keys->keys + keys->offsets[i]);
+    }
+}
+
+void writeLineKeys(LineVector *lv, int threads) {
+    if (lv->size == 0)
+        return;
+
+    // all keys are stored in one block, one after another
+    Keys keys = {lv, NULL, malloc(lv->size * sizeof (size_t))};
+    if (keys.offsets == NULL) {
+        allocationFailed();
+    }
+
+    size_t length = 0;
+    for (size_t i = 0; i < lv->size; ++i) {
+        keys.offsets[i] = length;
+        length += LineKeyLength(&lv->items[i]);
+    }
+
+    keys.keys = ArenaAlloc(&lv->arena, length);
+    parallelFor(lv->size, threads, writeKeys, &keys);
+
+    free(keys.offsets);
+}
+
+// writes keys of lines in order to be able to compare, then sorts lines
+void sortLineVector(LineVector *lv, int threads) {
+    if (lv->size == 0)
+        return;
+
+    statsPhase("keys");
+    writeLineKeys(lv, threads);
+
+    statsPhase("sort");
+    Line **order = sortLinePointers(lv, threads);
+    permuteLines(lv->items, order, lv->size);
+    free(order);
+}
+
+// puts each vector into bucket indexed by its first element
+// returns 0 if two vectors have the same first element
+static int bucketULLVectorVector(ULLVectorVector *v, unsigned long long first,
+                                 size_t range) {
+    size_t *buckets = calloc(range, sizeof (size_t)); // index + 1
+    ULLVector *items = malloc(v->allocated * sizeof (ULLVector));
+    if (buckets == NULL || items == NULL) {
+        allocationFailed();
+    }
+
+    for (size_t i = 0; i < v->size; ++i) {
+        size_t *bucket = &buckets[ULLVectorItems(&v->items[i])[0] - first];
+        if (*bucket != 0) {
+            free(buckets);
+            free(items);
+            return 0;
+        }
+        *bucket = i + 1;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < range; ++i) {
+        if (buckets[i] != 0)
+            items[n++] = v->items[buckets[i] - 1];
+    }
+
+    free(buckets);
+    free(v->items);
+    v->items = items;
+
+    return 1;
+}
+
+void sortULLVectorVector(ULLVectorVector *v) {
+    if (v->size <= 1)
+        return;
+
+    unsigned long long first = ULLVectorItems(&v->items[0])[0];
+    unsigned long long last = first;
+    for (size_t i = 1; i < v->size; ++i) {
+        unsigned long long x = ULLVectorItems(&v->items[i])[0];
+        if (x < first)
+            first = x;
+        if (x > last)
+            last = x;
+    }
+
+    // buckets are worth it if most of them are used
+    if (last - first < MAX_BUCKETS_PER_VECTOR * (unsigned long long)v->size &&
+        bucketULLVectorVector(v, first, (size_t)(last - first) + 1))
+        return;
+
+    qsort(v->items, v->size, sizeof (ULLVector), cmpULLVector);
+}
+
+int isSimilar(const Line* a, const Line* b)
+{
+    return cmpKey(a, b);
+}
+
+// compares words as strcmp would compare them ended by '\0'
+static int cmpWords(const void *a, const void *b) {
+    const StringView *x = a;
+    const StringView *y = b;
+    size_t length = x->length < y->length ? x->length : y->length;
+
+    int result = memcmp(x->data, y->data, length);
+    if (result != 0)
+        return result;
+    return (x->length > y->length) - (x->length < y->length);
+}
+
+KeyBuffer KeyBufferNew() {
+    KeyBuffer obj = {NULL, 0, NULL, 0};
+    return obj;
+}
+
+void KeyBufferFree(KeyBuffer *self) {
+    free(self->key);
+    free(self->words);
+}
+
+size_t writeContentKey(const Line *line, KeyBuffer *buffer) {
+    Line numbers = *line;
+    numbers.sv.size = 0;
+
+    size_t length = LineKeyLength(&numbers);
+
+    // line without words doesn't need buffer of words
+    if (line->sv.size > 0) {
+        if (line->sv.size > buffer->wordsAllocated) {
+            free(buffer->words);
+            buffer->words = malloc(line->sv.size * sizeof (StringView));
+            if (buffer->words == NULL) {
+                allocationFailed();
+            }
+            buffer->wordsAllocated = line->sv.size;
+        }
+
+        const unsigned int *ids = SVectorItems(&line->sv);
+        for (size_t i = 0; i < line->sv.size; ++i) {
+            buffer->words[i] = internedWord(ids[i]);
+            length += buffer->words[i].length + 1;
+        }
+        qsort(buffer->words, line->sv.size, sizeof (StringView), cmpWords);
+    }
+
+    if (length > buffer->allocated) {
+        free(buffer->key);
+        buffer->key = malloc(length);
+        if (buffer->key == NULL) {
+            allocationFailed();
+        }
+        buffer->allocated = length;
+    }
+
+    LineWriteKey(&numbers, buffer->key);
+    unsigned char *p = buffer->key + numbers.keyLength;
+    for (size_t i = 0; i < line->sv.size; ++i) {
+        memcpy(p, buffer->words[i].data, buffer->words[i].length);
+        p += buffer->words[i].length;
+        *p++ = '\0';
+    }
+
+    return length;
+}
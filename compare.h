@@ -1,25 +1,55 @@
-/**
- * Author:  Mateusz Malinowski
- * Date:    March 2021
- *
- * Summary of File:
- *
- *   This header provides functions to compare lines and sort line vector and
- *   vector of unsigned long long vectors.
- */
-
-#ifndef SIMILAR_LINES_COMPARE_H
-#define SIMILAR_LINES_COMPARE_H
-
-#include "line.h"
-#include "lineVector.h"
-#include "vector.h"
-
-// checks if two lines are similar
-int isSimilar(const Line* a, const Line* b);
-
-void sortLineVector(LineVector *lv);
-
-void sortULLVectorVector(ULLVectorVector *v);
-
-#endif //SIMILAR_LINES_COMPARE_H
+/**
+ * Author:  Mateusz Malinowski
+ * Date:    March 2021
+ *
+ * Summary of File:
+ *
+ *   This header provides functions to compare lines and sort line vector and
+ *   vector of unsigned long long vectors.
+ */
+
+#ifndef SIMILAR_LINES_COMPARE_H
+#define SIMILAR_LINES_COMPARE_H
+
+#include "intern.h"
+#include "line.h"
+#include "lineVector.h"
+#include "vector.h"
+
+// checks if two lines are similar, lines have to have keys
+// returns 0 if they are similar
+int isSimilar(const Line* a, const Line* b);
+
+// sorts each component vector of given line
+void sortElementsOfLine(Line *line);
+
+// sorts elements of each line and writes its key, keys are stored in arena
+// of line vector, work is split between given number of threads
+void writeLineKeys(LineVector *lv, int threads);
+
+// writes keys of lines and sorts lines, work is split between given number
+// of threads
+void sortLineVector(LineVector *lv, int threads);
+
+// buffers for content key of line
+typedef struct {
+    unsigned char *key;
+    size_t allocated;
+    StringView *words;
+    size_t wordsAllocated;
+} KeyBuffer;
+
+KeyBuffer KeyBufferNew();
+void KeyBufferFree(KeyBuffer *self);
+
+// writes key of line with sorted numbers into buffer, strings are written
+// as their sorted contents ended by '\0', so key doesn't depend on ids of
+// words, returns length of key
+size_t writeContentKey(const Line *line, KeyBuffer *buffer);
+
+// sorts non-empty vectors, in linear time if their first elements are
+// distinct numbers from a range not much wider than number of vectors,
+// as first line numbers of groups are
+void sortULLVectorVector(ULLVectorVector *v);
+
+#endif //SIMILAR_LINES_COMPARE_H
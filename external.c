@@ -0,0 +1,557 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements external-memory mode. Both sorts use the same
+ *   spill structure: records (key and payload) are collected in memory,
+ *   sorted and written to run files when batch reaches its limit, then
+ *   runs are merged by a heap, in several passes if there are too many of
+ *   them to be merged at once.
+ *   Keys of lines contain strings themselves instead of ids of interned
+ *   words, so dictionary of words is cleared after each batch and its size
+ *   doesn't grow with input. Payload of line is its big-endian number, so
+ *   similar lines are merged in order of their numbers. Groups are written
+ *   in chunks of bounded number of lines, so memory doesn't grow with size
+ *   of group. Key of chunk is big-endian number of the first line of its
+ *   group followed by big-endian index of chunk in group, and payload are
+ *   numbers of its lines, so chunks of group are merged one after another
+ *   and printed as they come.
+ *   Temporary directory is removed with its run files at exit, also when
+ *   the program fails.
+ */
+
+#include "external.h"
+
+#include "alloc.h"
+#include "arena.h"
+#include "compare.h"
+#include "intern.h"
+#include "line.h"
+#include "options.h"
+#include "output.h"
+#include "parse.h"
+#include "reader.h"
+#include "stats.h"
+#include "vector.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// buffer of each run file
+static const size_t RUN_BUFFER_SIZE = 1 << 16;
+
+// limits number of open files while merging
+static const size_t MAX_FAN_IN = 128;
+
+// maximal number of lines in payload of group record
+static const size_t GROUP_CHUNK_SIZE = 4096;
+
+static const int INITIAL_RECORDS_SIZE = 1024;
+
+// temporary directory, NULL if it was removed
+static char *temporaryDir = NULL;
+
+typedef struct {
+    size_t keyLength;
+    size_t payloadLength;
+    unsigned char data[];   // key followed by payload
+} Record;
+
+// called for records in sorted order
+typedef void (*recordConsumer)(const Record *record, void *arg);
+
+typedef struct {
+    Arena arena;            // records of current batch
+    Record **records;
+    size_t size;
+    size_t allocated;
+    size_t memory;          // bytes used by current batch
+    const char *dir;        // directory of run files
+    const char *name;       // prefix of names of run files
+    ULLVector runs;         // ids of runs which weren't merged yet
+    size_t firstRun;        // runs before it were merged
+    unsigned long long nextRun;
+    size_t fanIn;           // number of runs merged at once
+} Spill;
+
+// open run file with its current record
+typedef struct {
+    FILE *file;
+    Record *record;
+    size_t allocated;
+    unsigned long long id;
+} RunReader;
+
+static Spill SpillNew(const char *dir, const char *name, size_t mergeMemory) {
+    size_t fanIn = mergeMemory / RUN_BUFFER_SIZE;
+    if (fanIn < 2)
+        fanIn = 2;
+    if (fanIn > MAX_FAN_IN)
+        fanIn = MAX_FAN_IN;
+
+    Spill obj = {ArenaNew(), NULL, 0, 0, 0, dir, name, ULLVectorNew(), 0, 0,
+                 fanIn};
+    return obj;
+}
+
+static void SpillFree(Spill *self) {
+    ArenaFree(&self->arena);
+    free(self->records);
+    ULLVectorFree(&self->runs);
+}
+
+// removes temporary directory with all its files, registered by atexit,
+// so it doesn't allocate memory
+static void removeTemporaryDir(void) {
+    if (temporaryDir == NULL)
+        return;
+
+    DIR *dir = opendir(temporaryDir);
+    if (dir != NULL) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (strcmp(entry->d_name, ".") != 0 &&
+                strcmp(entry->d_name, "..") != 0)
+                unlinkat(dirfd(dir), entry->d_name, 0);
+        }
+        closedir(dir);
+    }
+    rmdir(temporaryDir);
+
+    free(temporaryDir);
+    temporaryDir = NULL;
+}
+
+static void failure(const char *what) {
+    perror(what);
+    exit(1);
+}
+
+// writes path of run into buffer of given size
+static void runPath(const Spill *self, unsigned long long id, char *path,
+                    size_t size) {
+    snprintf(path, size, "%s/%s-%llu", self->dir, self->name, id);
+}
+
+static FILE *openRun(const Spill *self, unsigned long long id,
+                     const char *mode) {
+    size_t size = strlen(self->dir) + strlen(self->name) + 32;
+    char *path = malloc(size);
+    if (path == NULL) {
+        allocationFailed();
+    }
+    runPath(self, id, path, size);
+
+    FILE *file = fopen(path, mode);
+    if (file == NULL)
+        failure(path);
+    setvbuf(file, NULL, _IOFBF, RUN_BUFFER_SIZE);
+
+    free(path);
+    return file;
+}
+
+static void removeRun(const Spill *self, unsigned long long id) {
+    size_t size = strlen(self->dir) + strlen(self->name) + 32;
+    char *path = malloc(size);
+    if (path == NULL) {
+        allocationFailed();
+    }
+    runPath(self, id, path, size);
+    unlink(path);
+    free(path);
+}
+
+// orders by key, then by payload
+static int cmpRecords(const Record *a, const Record *b) {
+    size_t n = a->keyLength < b->keyLength ? a->keyLength : b->keyLength;
+    int res = memcmp(a->data, b->data, n);
+    if (res != 0)
+        return res;
+    if (a->keyLength != b->keyLength)
+        return a->keyLength < b->keyLength ? -1 : 1;
+
+    n = a->payloadLength < b->payloadLength ? a->payloadLength
+                                            : b->payloadLength;
+    res = memcmp(a->data + a->keyLength, b->data + b->keyLength, n);
+    if (res != 0)
+        return res;
+    if (a->payloadLength != b->payloadLength)
+        return a->payloadLength < b->payloadLength ? -1 : 1;
+    return 0;
+}
+
+static int cmpRecordPointers(const void *a, const void *b) {
+    return cmpRecords(*(Record * const *)a, *(Record * const *)b);
+}
+
+static void SpillPush(Spill *self, const unsigned char *key,
+                      size_t keyLength, const unsigned char *payload,
+                      size_t payloadLength) {
+    if (self->size == self->allocated) {
+        size_t allocated = self->allocated == 0 ? INITIAL_RECORDS_SIZE
+                                                : self->allocated * 2;
+        self->records = realloc(self->records, allocated * sizeof (Record *));
+        if (self->records == NULL) {
+            allocationFailed();
+        }
+        self->memory += (allocated - self->allocated) * sizeof (Record *);
+        self->allocated = allocated;
+    }
+
+    size_t size = sizeof (Record) + keyLength + payloadLength;
+    Record *record = ArenaAlloc(&self->arena, size);
+    record->keyLength = keyLength;
+    record->payloadLength = payloadLength;
+    memcpy(record->data, key, keyLength);
+    memcpy(record->data + keyLength, payload, payloadLength);
+
+    self->records[self->size++] = record;
+    self->memory += size;
+}
+
+static void writeRecord(FILE *file, const Record *record) {
+    if (fwrite(record, sizeof (Record) + record->keyLength +
+                       record->payloadLength, 1, file) != 1)
+        failure("write");
+}
+
+// reads next record of run, returns 0 at end of run
+static int RunReaderNext(RunReader *self) {
+    Record header;
+    if (fread(&header, sizeof header, 1, self->file) != 1)
+        return 0;
+
+    size_t size = sizeof (Record) + header.keyLength + header.payloadLength;
+    if (size > self->allocated) {
+        free(self->record);
+        self->record = malloc(size);
+        if (self->record == NULL) {
+            allocationFailed();
+        }
+        self->allocated = size;
+    }
+
+    *self->record = header;
+    if (fread(self->record->data, size - sizeof (Record), 1,
+              self->file) != 1 && size > sizeof (Record))
+        failure("read");
+
+    return 1;
+}
+
+// sorts current batch and writes it as new run, batch becomes empty
+static void SpillFlush(Spill *self) {
+    if (self->size == 0)
+        return;
+
+    qsort(self->records, self->size, sizeof (Record *), cmpRecordPointers);
+
+    unsigned long long id = self->nextRun++;
+    FILE *file = openRun(self, id, "wb");
+    for (size_t i = 0; i < self->size; ++i) {
+        writeRecord(file, self->records[i]);
+    }
+    if (fclose(file) != 0)
+        failure("write");
+
+    ULLVectorPush(&self->runs, id);
+    ArenaFree(&self->arena);
+    self->size = 0;
+    self->memory = self->allocated * sizeof (Record *);
+}
+
+// moves down element i of heap of readers ordered by their records
+static void siftDown(RunReader **heap, size_t size, size_t i) {
+    while (1) {
+        size_t smallest = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+
+        if (left < size && cmpRecords(heap[left]->record,
+                                      heap[smallest]->record) < 0)
+            smallest = left;
+        if (right < size && cmpRecords(heap[right]->record,
+                                       heap[smallest]->record) < 0)
+            smallest = right;
+        if (smallest == i)
+            return;
+
+        RunReader *tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+// merges count oldest runs, passes their records to consumer and removes
+// the runs
+static void mergeRuns(Spill *self, size_t count, recordConsumer consumer,
+                      void *arg) {
+    RunReader *readers = malloc(count * sizeof (RunReader));
+    RunReader **heap = malloc(count * sizeof (RunReader *));
+    if (readers == NULL || heap == NULL) {
+        allocationFailed();
+    }
+
+    size_t size = 0;
+    for (size_t i = 0; i < count; ++i) {
+        unsigned long long id = ULLVectorItems(&self->runs)[self->firstRun++];
+        RunReader reader = {openRun(self, id, "rb"), NULL, 0, id};
+        readers[i] = reader;
+        if (RunReaderNext(&readers[i]))
+            heap[size++] = &readers[i];
+    }
+
+    for (size_t i = size; i-- > 0;) {
+        siftDown(heap, size, i);
+    }
+
+    while (size > 0) {
+        consumer(heap[0]->record, arg);
+        if (!RunReaderNext(heap[0]))
+            heap[0] = heap[--size];
+        siftDown(heap, size, 0);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        fclose(readers[i].file);
+        removeRun(self, readers[i].id);
+        free(readers[i].record);
+    }
+    free(heap);
+    free(readers);
+}
+
+static void writeToFile(const Record *record, void *arg) {
+    writeRecord(arg, record);
+}
+
+// passes all pushed records to consumer in sorted order
+static void SpillFinish(Spill *self, recordConsumer consumer, void *arg) {
+    if (self->runs.size == 0) {
+        qsort(self->records, self->size, sizeof (Record *),
+              cmpRecordPointers);
+        for (size_t i = 0; i < self->size; ++i) {
+            consumer(self->records[i], arg);
+        }
+        return;
+    }
+
+    SpillFlush(self);
+
+    // merge oldest runs into new ones until they can be merged at once
+    while (self->runs.size - self->firstRun > self->fanIn) {
+        unsigned long long id = self->nextRun++;
+        FILE *file = openRun(self, id, "wb");
+        mergeRuns(self, self->fanIn, writeToFile, file);
+        if (fclose(file) != 0)
+            failure("write");
+        ULLVectorPush(&self->runs, id);
+    }
+
+    mergeRuns(self, self->runs.size - self->firstRun, consumer, arg);
+}
+
+static void writeBigEndian(unsigned char *out, unsigned long long x) {
+    for (int i = 7; i >= 0; --i) {
+        *out++ = (unsigned char)(x >> (8 * i));
+    }
+}
+
+static unsigned long long readBigEndian(const unsigned char *in) {
+    unsigned long long x = 0;
+    for (int i = 0; i < 8; ++i) {
+        x = (x << 8) | in[i];
+    }
+    return x;
+}
+
+// converts stdin into runs of lines sorted by keys
+static void readLines(Spill *lines, size_t batchMemory) {
+    Reader reader = ReaderNewBuffered(fileno(stdin));
+    LineScanner scanner = LineScannerNew();
+    Line *line = LineNew(0);
+    KeyBuffer buffer = KeyBufferNew();
+    Writer errors = WriterNew(fileno(stderr));
+    unsigned long long nr = 0;
+    char *block = NULL;
+    size_t length = 0;
+    readStatus status;
+
+    while (ReaderNextBlock(&reader, &block, &length)) {
+        LineScannerReset(&scanner, block, length);
+
+        while ((status = LineScannerNext(&scanner, line)) != READ_END) {
+            ++nr;
+
+            if (status == READ_ERROR) {
+                WriterBytes(&errors, "ERROR ", 6);
+                WriterNumber(&errors, nr);
+                WriterChar(&errors, '\n');
+                continue;
+            }
+            if (status != READ_OK)
+                continue;
+
+            sortElementsOfLine(line);
+            size_t keyLength = writeContentKey(line, &buffer);
+            LineClear(line);
+
+            unsigned char payload[8];
+            writeBigEndian(payload, nr);
+            SpillPush(lines, buffer.key, keyLength, payload, sizeof payload);
+
+            // words are in keys, so they aren't needed after batch
+            if (lines->memory + internMemory() > batchMemory) {
+                SpillFlush(lines);
+                internFree();
+            }
+        }
+        WriterFlush(&errors);
+    }
+
+    WriterFree(&errors);
+    KeyBufferFree(&buffer);
+    LineFree(line);
+    free(line);
+    statsAddLines(&scanner.counts);
+    LineScannerFree(&scanner);
+    ReaderFree(&reader);
+}
+
+// collects numbers of lines with equal keys into chunks of groups
+typedef struct {
+    Spill *groups;
+    size_t batchMemory;
+    unsigned char *key;         // key of current group
+    size_t keyLength;
+    size_t keyAllocated;
+    unsigned long long first;   // number of the first line of current group
+    unsigned long long chunk;   // index of current chunk in group
+    ULLVector lines;            // numbers of lines of current chunk
+} GroupCollector;
+
+static void pushChunk(GroupCollector *self) {
+    if (self->lines.size == 0)
+        return;
+
+    unsigned char key[16];
+    writeBigEndian(key, self->first);
+    writeBigEndian(key + 8, self->chunk++);
+    SpillPush(self->groups, key, sizeof key,
+              (const unsigned char *)ULLVectorItems(&self->lines),
+              self->lines.size * sizeof (unsigned long long));
+    self->lines.size = 0;
+
+    if (self->groups->memory > self->batchMemory)
+        SpillFlush(self->groups);
+}
+
+static void collectLine(const Record *record, void *arg) {
+    GroupCollector *self = arg;
+    unsigned long long nr = readBigEndian(record->data + record->keyLength);
+
+    // there is no current group only before the first line
+    if ((self->chunk == 0 && self->lines.size == 0) ||
+        record->keyLength != self->keyLength ||
+        memcmp(record->data, self->key, self->keyLength) != 0) {
+        pushChunk(self);
+
+        if (record->keyLength > self->keyAllocated) {
+            free(self->key);
+            self->key = malloc(record->keyLength);
+            if (self->key == NULL) {
+                allocationFailed();
+            }
+            self->keyAllocated = record->keyLength;
+        }
+        memcpy(self->key, record->data, record->keyLength);
+        self->keyLength = record->keyLength;
+        self->first = nr;
+        self->chunk = 0;
+    }
+
+    ULLVectorPush(&self->lines, nr);
+    if (self->lines.size == GROUP_CHUNK_SIZE)
+        pushChunk(self);
+}
+
+// prints chunks of groups, each group in its own line
+typedef struct {
+    Writer *writer;
+    int open;                   // set if line of group isn't ended
+} GroupPrinter;
+
+static void printChunk(const Record *record, void *arg) {
+    GroupPrinter *self = arg;
+    const unsigned char *payload = record->data + record->keyLength;
+    size_t n = record->payloadLength / sizeof (unsigned long long);
+
+    // the first chunk of group ends line of previous group
+    if (readBigEndian(record->data + 8) == 0 && self->open) {
+        WriterChar(self->writer, '\n');
+        self->open = 0;
+    }
+
+    // in order to not print space at end of line
+    for (size_t i = 0; i < n; ++i) {
+        unsigned long long nr;
+        memcpy(&nr, payload + i * sizeof nr, sizeof nr);
+        if (i > 0 || self->open)
+            WriterChar(self->writer, ' ');
+        WriterNumber(self->writer, nr);
+        self->open = 1;
+    }
+}
+
+void findSimilarExternally(const Options *options) {
+    size_t limit = options->memoryLimit;
+
+    const char *base = options->tempDir;
+    if (base == NULL)
+        base = getenv("TMPDIR");
+    if (base == NULL || base[0] == '\0')
+        base = "/tmp";
+
+    char *dir = malloc(strlen(base) + 32);
+    if (dir == NULL) {
+        allocationFailed();
+    }
+    sprintf(dir, "%s/similar_lines.XXXXXX", base);
+    if (mkdtemp(dir) == NULL)
+        failure(dir);
+    temporaryDir = dir;
+    atexit(removeTemporaryDir);
+
+    // reader and writers take 1 MiB each, merges take a quarter of budget,
+    // batches the rest
+    Spill lines = SpillNew(dir, "lines", limit / 4);
+    Spill groups = SpillNew(dir, "groups", limit / 4);
+
+    statsPhase("read");
+    readLines(&lines, limit / 2);
+
+    statsPhase("merge");
+    GroupCollector collector = {&groups, limit / 4, NULL, 0, 0, 0, 0,
+                                ULLVectorNew()};
+    SpillFinish(&lines, collectLine, &collector);
+    pushChunk(&collector);
+    free(collector.key);
+    ULLVectorFree(&collector.lines);
+    SpillFree(&lines);
+    internFree();
+
+    statsPhase("print");
+    Writer writer = WriterNew(fileno(stdout));
+    GroupPrinter printer = {&writer, 0};
+    SpillFinish(&groups, printChunk, &printer);
+    if (printer.open)
+        WriterChar(&writer, '\n');
+    WriterFree(&writer);
+    SpillFree(&groups);
+
+    removeTemporaryDir();
+}
@@ -0,0 +1,24 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides external-memory mode for inputs which don't fit
+ *   in memory. Lines are converted in batches limited by memory budget,
+ *   each batch is sorted by canonical keys and written as a run to
+ *   temporary directory. Runs are merged, so similar lines become
+ *   neighbours, and found groups are sorted by their first lines in the
+ *   same way. Output is the same as in normal mode.
+ *   Memory limit doesn't cover single line: each line is kept whole by
+ *   reader and converted in memory together with its key, so line longer
+ *   than the limit makes memory exceed it.
+ */
+
+#ifndef SIMILAR_LINES_EXTERNAL_H
+#define SIMILAR_LINES_EXTERNAL_H
+
+#include "options.h"
+
+// reads stdin and prints groups of similar lines using at most about
+// options->memoryLimit bytes of memory besides the longest line
+void findSimilarExternally(const Options *options);
+
+#endif //SIMILAR_LINES_EXTERNAL_H
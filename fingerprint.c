@@ -0,0 +1,128 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements line fingerprint. Each element is hashed together
+ *   with its type and hashes are summed in two independent ways, so the
+ *   result is order independent, but it still changes when element is added,
+ *   removed or repeated.
+ */
+
+#include "fingerprint.h"
+
+#include "intern.h"
+#include "line.h"
+#include "sort.h"
+#include "vector.h"
+
+#include <string.h>
+
+static const unsigned long long ULL_SEED = 0x243f6a8885a308d3ULL;
+static const unsigned long long LL_SEED = 0x13198a2e03707344ULL;
+static const unsigned long long D_SEED = 0xa4093822299f31d0ULL;
+static const unsigned long long S_SEED = 0x082efa98ec4e6c89ULL;
+static const unsigned long long REPEAT_SEED = 0xbe5466cf34e90c6cULL;
+
+// finalizer of splitmix64 generator, it mixes all bits of x
+static unsigned long long mix(unsigned long long x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// FNV-1a hash
+unsigned long long hashBytes(const char *bytes, size_t length) {
+    unsigned long long h = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < length; ++i) {
+        h ^= (unsigned char)bytes[i];
+        h *= 0x100000001b3ULL;
+    }
+
+    return mix(h);
+}
+
+unsigned long long hashNumber(unsigned long long x) {
+    return mix(x);
+}
+
+static void addElement(Fingerprint *fp, unsigned long long h) {
+    fp->low += h;
+    fp->high += mix(h ^ 0x452821e638d01377ULL);
+}
+
+Fingerprint lineFingerprint(const Line *line) {
+    Fingerprint fp = {0, 0};
+    const unsigned long long *ulls = ULLVectorItems(&line->ullv);
+    const long long *lls = LLVectorItems(&line->llv);
+    const double *ds = DVectorItems(&line->dv);
+    const unsigned int *ids = SVectorItems(&line->sv);
+
+    for (size_t i = 0; i < line->ullv.size; ++i) {
+        addElement(&fp, mix(ulls[i] + ULL_SEED));
+    }
+    for (size_t i = 0; i < line->llv.size; ++i) {
+        addElement(&fp, mix((unsigned long long)lls[i] + LL_SEED));
+    }
+    for (size_t i = 0; i < line->dv.size; ++i) {
+        unsigned long long bits;
+        memcpy(&bits, &ds[i], sizeof bits);
+        addElement(&fp, mix(bits + D_SEED));
+    }
+    for (size_t i = 0; i < line->sv.size; ++i) {
+        addElement(&fp, mix(internedHash(ids[i]) + S_SEED));
+    }
+
+    return fp;
+}
+
+void lineElementHashes(const Line *line, ULLVector *hashes) {
+    size_t first = hashes->size;
+    const unsigned long long *ulls = ULLVectorItems(&line->ullv);
+    const long long *lls = LLVectorItems(&line->llv);
+    const double *ds = DVectorItems(&line->dv);
+    const unsigned int *ids = SVectorItems(&line->sv);
+
+    for (size_t i = 0; i < line->ullv.size; ++i) {
+        ULLVectorPush(hashes, mix(ulls[i] + ULL_SEED));
+    }
+    for (size_t i = 0; i < line->llv.size; ++i) {
+        ULLVectorPush(hashes, mix((unsigned long long)lls[i] + LL_SEED));
+    }
+    for (size_t i = 0; i < line->dv.size; ++i) {
+        unsigned long long bits;
+        memcpy(&bits, &ds[i], sizeof bits);
+        ULLVectorPush(hashes, mix(bits + D_SEED));
+    }
+    for (size_t i = 0; i < line->sv.size; ++i) {
+        ULLVectorPush(hashes, mix(internedHash(ids[i]) + S_SEED));
+    }
+
+    unsigned long long *items = ULLVectorItems(hashes) + first;
+    size_t n = hashes->size - first;
+    sortULLArray(items, n);
+
+    // k-th repetition of hash h is replaced by hash of h and k
+    unsigned long long previous = n > 0 ? items[0] : 0;
+    unsigned long long k = 0;
+    int repeated = 0;
+    for (size_t i = 1; i < n; ++i) {
+        if (items[i] == previous) {
+            items[i] = mix(previous ^ mix(++k + REPEAT_SEED));
+            repeated = 1;
+        }
+        else {
+            previous = items[i];
+            k = 0;
+        }
+    }
+
+    if (repeated)
+        sortULLArray(items, n);
+}
+
+int fingerprintEqual(Fingerprint a, Fingerprint b) {
+    return a.low == b.low && a.high == b.high;
+}
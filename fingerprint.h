@@ -0,0 +1,40 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides fingerprint of line. Fingerprint doesn't depend on
+ *   order of elements in line, so similar lines always have equal
+ *   fingerprints. Different lines have equal fingerprints only on (very
+ *   unlikely) collision.
+ */
+
+#ifndef SIMILAR_LINES_FINGERPRINT_H
+#define SIMILAR_LINES_FINGERPRINT_H
+
+#include "line.h"
+#include "vector.h"
+
+#include <stdlib.h>
+
+typedef struct {
+    unsigned long long low;
+    unsigned long long high;
+} Fingerprint;
+
+// returns 64-bit hash of given bytes
+unsigned long long hashBytes(const char *bytes, size_t length);
+
+// returns 64-bit hash of given number, all bits of number affect all bits
+// of hash
+unsigned long long hashNumber(unsigned long long x);
+
+Fingerprint lineFingerprint(const Line *line);
+
+// pushes sorted hashes of elements of line into hashes, each repetition of
+// element has different hash, so multisets of elements of lines can be
+// compared as sets of hashes
+void lineElementHashes(const Line *line, ULLVector *hashes);
+
+// returns 1 if fingerprints are equal, 0 otherwise
+int fingerprintEqual(Fingerprint a, Fingerprint b);
+
+#endif //SIMILAR_LINES_FINGERPRINT_H
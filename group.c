@@ -0,0 +1,296 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements functions which find groups of similar lines.
+ *   Hashing by many threads uses table of fixed size, which is at most half
+ *   full, so slots are only filled and never moved. Each thread claims
+ *   empty slot by compare-and-swap, lines of one class have the same probe
+ *   sequence, so the first of them to claim a slot becomes representative
+ *   of class and others find it. Which line becomes representative depends
+ *   on timing, but classes don't, and groups are collected in input order
+ *   by one pass, so output is the same for any number of threads.
+ */
+
+#include "group.h"
+
+#include "alloc.h"
+#include "compare.h"
+#include "fingerprint.h"
+#include "line.h"
+#include "lineVector.h"
+#include "parallel.h"
+#include "stats.h"
+#include "vector.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+const size_t INITIAL_TABLE_SIZE = 64;
+
+// minimal number of lines for which hashing is split between threads
+const size_t MIN_PARALLEL_HASHING = 1 << 14;
+
+// class of similar lines
+typedef struct {
+    Fingerprint fp;
+    const Line *representative;
+    ULLVector lines;
+} Class;
+
+// hash table of classes with open addressing
+typedef struct {
+    size_t *slots;  // index of class + 1, 0 means empty slot
+    size_t capacity;
+    Class *classes; // in order of their first lines
+    size_t size;
+    size_t allocated;
+} ClassTable;
+
+// hash table of lines filled by many threads
+typedef struct {
+    const LineVector *lv;
+    Fingerprint *fps;           // fingerprint of each line
+    atomic_size_t *slots;       // index of line + 1, 0 means empty slot
+    size_t mask;                // number of slots - 1
+    size_t *classOf;            // index of representative of each line
+} ConcurrentTable;
+
+void groupBySorting(LineVector *lv, int threads, ULLVectorVector *groups) {
+    sortLineVector(lv, threads);
+
+    if (lv->size == 0)
+        return;
+
+    statsPhase("group");
+
+    ULLVector similarLines = ULLVectorNew();
+    Line *lastLine = NULL;
+
+    ULLVectorPush(&similarLines, lv->items[0].nr);
+    lastLine = &lv->items[0];
+
+    for (size_t i = 1; i < lv->size; ++i) {
+        if (isSimilar(lastLine, &lv->items[i]) == 0) {
+            ULLVectorPush(&similarLines, lv->items[i].nr);
+        }
+        else {
+            ULLVectorVectorPush(groups, similarLines);
+            similarLines = ULLVectorNew();
+            ULLVectorPush(&similarLines, lv->items[i].nr);
+            lastLine = &lv->items[i];
+        }
+    }
+    ULLVectorVectorPush(groups, similarLines); // push last group
+
+    statsPhase("order");
+    sortULLVectorVector(groups);
+}
+
+static ClassTable ClassTableNew() {
+    ClassTable obj = {NULL, INITIAL_TABLE_SIZE, NULL, 0, 0};
+
+    obj.slots = calloc(obj.capacity, sizeof (size_t));
+    if (obj.slots == NULL) {
+        allocationFailed();
+    }
+
+    return obj;
+}
+
+// frees table, but not line vectors of classes
+static void ClassTableFree(ClassTable *self) {
+    free(self->slots);
+    free(self->classes);
+}
+
+// doubles number of slots and puts all classes into new slots
+static void ClassTableGrow(ClassTable *self) {
+    size_t capacity = self->capacity * 2;
+    size_t *slots = calloc(capacity, sizeof (size_t));
+    if (slots == NULL) {
+        allocationFailed();
+    }
+
+    for (size_t i = 0; i < self->size; ++i) {
+        size_t j = self->classes[i].fp.low & (capacity - 1);
+        while (slots[j] != 0) {
+            j = (j + 1) & (capacity - 1);
+        }
+        slots[j] = i + 1;
+    }
+
+    free(self->slots);
+    self->slots = slots;
+    self->capacity = capacity;
+}
+
+// appends new class, returns its index
+static size_t ClassTablePushClass(ClassTable *self, Class c) {
+    size_t typeSize = sizeof c;
+    if (self->allocated == 0) {
+        self->classes = malloc(INITIAL_TABLE_SIZE * typeSize);
+        if (self->classes == NULL) {
+            allocationFailed();
+        }
+        self->allocated = INITIAL_TABLE_SIZE;
+    } else if (self->size == self->allocated) {
+        Class *classes = realloc(self->classes, self->allocated * 2 * typeSize);
+        if (classes == NULL) {
+            allocationFailed();
+        }
+        self->classes = classes;
+        self->allocated *= 2;
+    }
+
+    self->classes[self->size] = c;
+
+    return self->size++;
+}
+
+// finds class of given line or creates new one, then adds line to it
+static void ClassTableInsert(ClassTable *self, const Line *line) {
+    Fingerprint fp = lineFingerprint(line);
+    size_t mask = self->capacity - 1;
+    size_t j = fp.low & mask;
+
+    while (self->slots[j] != 0) {
+        Class *c = &self->classes[self->slots[j] - 1];
+
+        if (fingerprintEqual(c->fp, fp) &&
+            isSimilar(c->representative, line) == 0) {
+            ULLVectorPush(&c->lines, line->nr);
+            return;
+        }
+
+        j = (j + 1) & mask;
+    }
+
+    Class c = {fp, line, ULLVectorNew()};
+    ULLVectorPush(&c.lines, line->nr);
+    self->slots[j] = ClassTablePushClass(self, c) + 1;
+
+    // keep load factor at most 1/2
+    if (2 * self->size > self->capacity)
+        ClassTableGrow(self);
+}
+
+static void computeFingerprints(size_t begin, size_t end, void *arg) {
+    ConcurrentTable *t = arg;
+
+    for (size_t i = begin; i < end; ++i) {
+        t->fps[i] = lineFingerprint(&t->lv->items[i]);
+    }
+}
+
+// finds representative of each line or makes line one
+// fingerprints and keys are written before threads start and slots only
+// point at them, so relaxed order is enough
+static void insertConcurrently(size_t begin, size_t end, void *arg) {
+    ConcurrentTable *t = arg;
+
+    for (size_t i = begin; i < end; ++i) {
+        const Line *line = &t->lv->items[i];
+        Fingerprint fp = t->fps[i];
+        size_t j = fp.low & t->mask;
+
+        for (;;) {
+            size_t slot = atomic_load_explicit(&t->slots[j],
+                                               memory_order_relaxed);
+            if (slot == 0) {
+                if (atomic_compare_exchange_strong_explicit(
+                        &t->slots[j], &slot, i + 1, memory_order_relaxed,
+                        memory_order_relaxed)) {
+                    t->classOf[i] = i;
+                    break;
+                }
+                // slot was claimed by other thread, slot is its value now
+            }
+
+            size_t r = slot - 1;
+            if (fingerprintEqual(t->fps[r], fp) &&
+                isSimilar(&t->lv->items[r], line) == 0) {
+                t->classOf[i] = r;
+                break;
+            }
+
+            j = (j + 1) & t->mask;
+        }
+    }
+}
+
+// puts lines into groups in input order, so groups are ordered by their
+// first lines
+static void collectClasses(const ConcurrentTable *t,
+                           ULLVectorVector *groups) {
+    size_t n = t->lv->size;
+    size_t *groupOf = malloc(n * sizeof (size_t));
+    if (groupOf == NULL) {
+        allocationFailed();
+    }
+    for (size_t i = 0; i < n; ++i) {
+        groupOf[i] = SIZE_MAX;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        size_t r = t->classOf[i];
+
+        if (groupOf[r] == SIZE_MAX) {
+            groupOf[r] = groups->size;
+            ULLVectorVectorPush(groups, ULLVectorNew());
+        }
+        ULLVectorPush(&groups->items[groupOf[r]], t->lv->items[i].nr);
+    }
+
+    free(groupOf);
+}
+
+static void groupByHashingConcurrently(LineVector *lv, int threads,
+                                       ULLVectorVector *groups) {
+    size_t capacity = INITIAL_TABLE_SIZE;
+    while (capacity < 2 * lv->size) {
+        capacity *= 2;
+    }
+
+    ConcurrentTable t;
+    t.lv = lv;
+    t.mask = capacity - 1;
+    t.fps = malloc(lv->size * sizeof (Fingerprint));
+    t.slots = calloc(capacity, sizeof (atomic_size_t));
+    t.classOf = malloc(lv->size * sizeof (size_t));
+    if (t.fps == NULL || t.slots == NULL || t.classOf == NULL) {
+        allocationFailed();
+    }
+
+    parallelFor(lv->size, threads, computeFingerprints, &t);
+    parallelFor(lv->size, threads, insertConcurrently, &t);
+    collectClasses(&t, groups);
+
+    free(t.fps);
+    free(t.slots);
+    free(t.classOf);
+}
+
+void groupByHashing(LineVector *lv, int threads, ULLVectorVector *groups) {
+    statsPhase("keys");
+    writeLineKeys(lv, threads);
+
+    statsPhase("group");
+    if (threads > 1 && lv->size >= MIN_PARALLEL_HASHING) {
+        groupByHashingConcurrently(lv, threads, groups);
+        return;
+    }
+
+    ClassTable table = ClassTableNew();
+    for (size_t i = 0; i < lv->size; ++i) {
+        ClassTableInsert(&table, &lv->items[i]);
+    }
+
+    // lines are in input order, so classes are created in order of their
+    // first lines and don't have to be sorted
+    for (size_t i = 0; i < table.size; ++i) {
+        ULLVectorVectorPush(groups, table.classes[i].lines);
+    }
+
+    ClassTableFree(&table);
+}
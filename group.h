@@ -0,0 +1,26 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides functions which find groups of similar lines.
+ *   Each group is a vector of ascending line numbers and groups are ordered
+ *   by their first line number.
+ */
+
+#ifndef SIMILAR_LINES_GROUP_H
+#define SIMILAR_LINES_GROUP_H
+
+#include "lineVector.h"
+#include "vector.h"
+
+// sorts all lines, so similar lines are next to each other and groups them
+// complexity is O(n*log(n)*cmp_t), sorting is done by given number of threads
+void groupBySorting(LineVector *lv, int threads, ULLVectorVector *groups);
+
+// puts lines into hash table by their fingerprints, lines are compared only
+// when fingerprints are equal
+// expected complexity is linear in size of input, lines are inserted into
+// one table by given number of threads
+// lines in lv have to be in input order
+void groupByHashing(LineVector *lv, int threads, ULLVectorVector *groups);
+
+#endif //SIMILAR_LINES_GROUP_H
@@ -0,0 +1,280 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements index described in related header. Both modes
+ *   read input block by block and don't keep lines, only fingerprint of
+ *   each line is computed. Index is built in memory as hash table with
+ *   linear probing, which is at most half full, and it is written as it
+ *   is after header, so the table in file can be searched in the same way.
+ *   Lines are equal to a class when their fingerprints are equal, so line
+ *   can be assigned to wrong class only on (very unlikely) collision of
+ *   128-bit fingerprints.
+ *   Search visits each slot at most once, so corrupted index file without
+ *   free slot is reported instead of being searched forever.
+ */
+
+#include "index.h"
+
+#include "alloc.h"
+#include "fingerprint.h"
+#include "line.h"
+#include "options.h"
+#include "output.h"
+#include "parse.h"
+#include "reader.h"
+#include "stats.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// "SLINDEX1" read as big-endian number, so file of other byte order or
+// version isn't accepted
+static const unsigned long long INDEX_MAGIC = 0x534c494e44455831ULL;
+
+static const size_t INITIAL_INDEX_SIZE = 1024;
+
+// one slot of hash table, slot with nr 0 is empty
+typedef struct {
+    unsigned long long low;     // fingerprint of lines of class
+    unsigned long long high;
+    unsigned long long nr;      // number of the first line of class
+    unsigned long long count;   // number of lines of class
+} IndexEntry;
+
+// beginning of index file, it's followed by slots of table
+typedef struct {
+    unsigned long long magic;
+    unsigned long long classes;
+    unsigned long long size;    // number of slots, power of 2
+    unsigned long long lines;   // number of correct lines of corpus
+} IndexHeader;
+
+typedef struct {
+    IndexEntry *slots;
+    size_t size;
+    size_t classes;
+    unsigned long long lines;
+} IndexTable;
+
+// result of query is written by it
+typedef struct {
+    const IndexEntry *slots;
+    size_t size;
+    const char *path;
+    Writer output;
+} Query;
+
+// called for each correct line with its number
+typedef void (*lineHandler)(void *context, const Line *line,
+                            unsigned long long nr);
+
+static void failure(const char *what) {
+    perror(what);
+    exit(1);
+}
+
+// prints that file isn't correct index and exits
+static void notIndex(const char *path) {
+    fprintf(stderr, "%s: not an index file\n", path);
+    exit(1);
+}
+
+// returns position of slot with given fingerprint or of empty slot where
+// it should be inserted, size if table is full and doesn't have it
+static size_t findSlot(const IndexEntry *slots, size_t size, Fingerprint fp) {
+    size_t i = (size_t)fp.low & (size - 1);
+
+    for (size_t step = 0; step < size; ++step) {
+        if (slots[i].nr == 0 ||
+            (slots[i].low == fp.low && slots[i].high == fp.high))
+            return i;
+        i = (i + 1) & (size - 1);
+    }
+
+    return size;
+}
+
+static IndexTable IndexTableNew() {
+    IndexTable obj = {NULL, INITIAL_INDEX_SIZE, 0, 0};
+
+    obj.slots = calloc(obj.size, sizeof (IndexEntry));
+    if (obj.slots == NULL) {
+        allocationFailed();
+    }
+
+    return obj;
+}
+
+static void IndexTableFree(IndexTable *self) {
+    free(self->slots);
+}
+
+static void IndexTableGrow(IndexTable *self) {
+    size_t size = self->size * 2;
+    IndexEntry *slots = calloc(size, sizeof (IndexEntry));
+    if (slots == NULL) {
+        allocationFailed();
+    }
+
+    for (size_t i = 0; i < self->size; ++i) {
+        if (self->slots[i].nr != 0) {
+            Fingerprint fp = {self->slots[i].low, self->slots[i].high};
+            slots[findSlot(slots, size, fp)] = self->slots[i];
+        }
+    }
+
+    free(self->slots);
+    self->slots = slots;
+    self->size = size;
+}
+
+// adds line to its class, lines have to be added in input order
+static void IndexTableInsert(void *context, const Line *line,
+                             unsigned long long nr) {
+    IndexTable *self = context;
+    Fingerprint fp = lineFingerprint(line);
+    IndexEntry *slot = &self->slots[findSlot(self->slots, self->size, fp)];
+
+    self->lines++;
+
+    if (slot->nr != 0) {
+        slot->count++;
+        return;
+    }
+
+    IndexEntry entry = {fp.low, fp.high, nr, 1};
+    *slot = entry;
+
+    if (++self->classes * 2 > self->size)
+        IndexTableGrow(self);
+}
+
+// writes header and table into file
+static void IndexTableWrite(const IndexTable *self, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+        failure(path);
+
+    IndexHeader header = {INDEX_MAGIC, self->classes, self->size,
+                          self->lines};
+
+    if (fwrite(&header, sizeof header, 1, file) != 1 ||
+        fwrite(self->slots, sizeof (IndexEntry), self->size, file) !=
+        self->size || fclose(file) != 0)
+        failure(path);
+}
+
+// writes number of line and number of the first line of its class
+static void queryLine(void *context, const Line *line,
+                      unsigned long long nr) {
+    Query *self = context;
+    size_t i = findSlot(self->slots, self->size, lineFingerprint(line));
+
+    // table of correct index is never full
+    if (i == self->size) {
+        WriterFree(&self->output);
+        notIndex(self->path);
+    }
+    const IndexEntry *slot = &self->slots[i];
+
+    WriterNumber(&self->output, nr);
+    WriterChar(&self->output, ' ');
+    if (slot->nr != 0)
+        WriterNumber(&self->output, slot->nr);
+    else
+        WriterBytes(&self->output, "new", 3);
+    WriterChar(&self->output, '\n');
+}
+
+// reads stdin and calls handler for each correct line, numbers of
+// incorrect lines are printed on stderr
+static void readLines(lineHandler handler, void *context) {
+    Reader reader = ReaderNew(fileno(stdin));
+    LineScanner scanner = LineScannerNew();
+    Line *line = LineNew(0);
+    Writer errors = WriterNew(fileno(stderr));
+    unsigned long long nr = 0;
+    char *block = NULL;
+    size_t length = 0;
+    readStatus status;
+
+    while (ReaderNextBlock(&reader, &block, &length) > 0) {
+        LineScannerReset(&scanner, block, length);
+
+        while ((status = LineScannerNext(&scanner, line)) != READ_END) {
+            ++nr;
+
+            if (status == READ_OK) {
+                handler(context, line, nr);
+                LineClear(line);
+            }
+            else if (status == READ_ERROR) {
+                WriterBytes(&errors, "ERROR ", 6);
+                WriterNumber(&errors, nr);
+                WriterChar(&errors, '\n');
+            }
+        }
+    }
+
+    WriterFree(&errors);
+    statsAddLines(&scanner.counts);
+    LineFree(line);
+    free(line);
+    LineScannerFree(&scanner);
+    ReaderFree(&reader);
+}
+
+void buildIndex(const Options *options) {
+    IndexTable table = IndexTableNew();
+
+    statsPhase("read");
+    readLines(IndexTableInsert, &table);
+
+    statsPhase("write");
+    IndexTableWrite(&table, options->buildIndex);
+
+    IndexTableFree(&table);
+}
+
+void queryIndex(const Options *options) {
+    const char *path = options->queryIndex;
+    struct stat st;
+
+    statsPhase("open");
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0)
+        failure(path);
+
+    size_t fileSize = (size_t)st.st_size;
+    const IndexHeader *header = NULL;
+    if (fileSize >= sizeof *header) {
+        header = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (header == MAP_FAILED)
+            failure(path);
+    }
+    close(fd);
+
+    size_t slotsSize = fileSize - sizeof *header;
+    if (header == NULL || header->magic != INDEX_MAGIC ||
+        slotsSize % sizeof (IndexEntry) != 0 ||
+        slotsSize / sizeof (IndexEntry) != header->size ||
+        (header->size & (header->size - 1)) != 0 ||
+        header->classes >= header->size)
+        notIndex(path);
+
+    // only slots of queried lines are read
+    posix_madvise((void *)header, fileSize, POSIX_MADV_RANDOM);
+
+    Query query = {(const IndexEntry *)(header + 1), (size_t)header->size,
+                   path, WriterNew(fileno(stdout))};
+
+    statsPhase("query");
+    readLines(queryLine, &query);
+
+    WriterFree(&query.output);
+    munmap((void *)header, fileSize);
+}
@@ -0,0 +1,27 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides persistent index of classes of similar lines.
+ *   Index is built from a corpus and stores for each class fingerprint of
+ *   its lines (see fingerprint.h), which depends only on content of line,
+ *   number of its first line and number of its lines. Index file is a hash
+ *   table which is mapped into memory when it is queried, so query doesn't
+ *   read whole index and its time is proportional to size of new input.
+ *   Query prints for each correct line of new input its number and number
+ *   of the first line of its class in corpus or "new" if there is no such
+ *   class.
+ *   Index file is in byte order of the machine which built it.
+ */
+
+#ifndef SIMILAR_LINES_INDEX_H
+#define SIMILAR_LINES_INDEX_H
+
+#include "options.h"
+
+// reads stdin and writes index of its classes to options->buildIndex
+void buildIndex(const Options *options);
+
+// reads stdin and prints class of each line in index options->queryIndex
+void queryIndex(const Options *options);
+
+#endif //SIMILAR_LINES_INDEX_H
@@ -0,0 +1,328 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements dictionary of words. It is a hash table with open
+ *   addressing which stores ids of words and entries of words indexed by
+ *   their ids. Words themselves are stored in arena, unless they are in
+ *   retained memory, then entries point into it.
+ *   Dictionary is guarded by a mutex, so words can be interned by many
+ *   threads at once. Entries are kept in segments of growing size, which
+ *   never move, so entry of known id can be read without lock while other
+ *   threads intern words.
+ */
+
+#include "intern.h"
+
+#include "alloc.h"
+#include "arena.h"
+#include "fingerprint.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+const size_t INITIAL_DICTIONARY_SIZE = 1024;
+
+const size_t INITIAL_MAPPINGS_SIZE = 4;
+
+// returned by findOrInsert when memory can't be allocated
+#define NO_WORD ((unsigned int)-1)
+
+// segment s has FIRST_SEGMENT_SIZE << s entries, 32 segments are enough
+// for all ids
+#define FIRST_SEGMENT_SIZE 1024
+#define SEGMENTS 32
+
+typedef struct {
+    const char *word;
+    size_t length;
+    unsigned long long hash;
+} Entry;
+
+// memory mapped by reader, words of entries may point into it
+typedef struct {
+    void *data;
+    size_t size;
+} Mapping;
+
+struct Dictionary {
+    unsigned int *slots;        // id of word + 1, 0 means empty slot
+    size_t capacity;
+    Entry *segments[SEGMENTS];  // entries of words indexed by ids
+    size_t size;
+    size_t allocated;           // number of entries in segments
+    Arena words;
+    Mapping *mappings;
+    size_t mappingCount;
+    size_t mappingsAllocated;
+    pthread_mutex_t lock;
+    unsigned int generation;    // changed when dictionary is cleared
+};
+
+// dictionary used by threads which didn't choose other one
+static Dictionary global = {NULL, 0, {NULL}, 0, 0, {NULL, NULL, 0, 0}, NULL,
+                            0, 0, PTHREAD_MUTEX_INITIALIZER, 1};
+
+// dictionary chosen by internUse, NULL means the global one
+static _Thread_local Dictionary *current = NULL;
+
+// recently used words of each thread, so threads which parse lines with
+// the same words don't fight for the lock
+typedef struct {
+    const char *word;
+    size_t length;
+    unsigned int id;
+    unsigned int generation;
+} CachedWord;
+
+#define WORD_CACHE_SIZE 1024
+
+static _Thread_local CachedWord cache[WORD_CACHE_SIZE];
+
+// the last generation given to a dictionary, each cleared or new dictionary
+// gets a new one, so words cached before aren't used
+static atomic_uint lastGeneration = 1;
+
+static Dictionary *dictionary(void) {
+    return current != NULL ? current : &global;
+}
+
+// returns entry of word with given id
+static Entry *entry(const Dictionary *self, unsigned int id) {
+    unsigned long long k = (unsigned long long)id / FIRST_SEGMENT_SIZE + 1;
+    int segment = 63 - __builtin_clzll(k);
+    size_t first = FIRST_SEGMENT_SIZE * ((1ULL << segment) - 1);
+
+    return &self->segments[segment][id - first];
+}
+
+// adds segment after the last one, returns 0 if there is no memory
+static int allocateSegment(Dictionary *self) {
+    int segment = 0;
+    while (self->segments[segment] != NULL) {
+        segment++;
+    }
+
+    size_t size = (size_t)FIRST_SEGMENT_SIZE << segment;
+    self->segments[segment] = malloc(size * sizeof (Entry));
+    if (self->segments[segment] == NULL)
+        return 0;
+    self->allocated += size;
+    return 1;
+}
+
+// returns table of given capacity with slots of all words, NULL if there is
+// no memory
+static unsigned int *rehash(const Dictionary *self, size_t capacity) {
+    unsigned int *slots = calloc(capacity, sizeof (unsigned int));
+    if (slots == NULL)
+        return NULL;
+
+    for (size_t i = 0; i < self->size; ++i) {
+        size_t j = entry(self, (unsigned int)i)->hash & (capacity - 1);
+        while (slots[j] != 0) {
+            j = (j + 1) & (capacity - 1);
+        }
+        slots[j] = (unsigned int)i + 1;
+    }
+
+    return slots;
+}
+
+// returns slot of word or empty slot where it should be inserted
+static size_t findSlot(const Dictionary *self, const char *word,
+                       size_t length, unsigned long long hash) {
+    size_t mask = self->capacity - 1;
+    size_t j = hash & mask;
+
+    while (self->slots[j] != 0) {
+        Entry *e = entry(self, self->slots[j] - 1);
+        if (e->hash == hash && e->length == length &&
+            memcmp(e->word, word, length) == 0)
+            break;
+        j = (j + 1) & mask;
+    }
+
+    return j;
+}
+
+// finds word in dictionary or adds it, dictionary has to be locked
+// retained word is added without copying it
+// returns NO_WORD if there is no memory, so the caller can unlock the
+// dictionary before it fails, dictionary stays unchanged then
+static unsigned int findOrInsert(Dictionary *self, const char *word,
+                                 size_t length, unsigned long long hash,
+                                 int retained) {
+    if (self->capacity == 0) {
+        self->slots = rehash(self, INITIAL_DICTIONARY_SIZE);
+        if (self->slots == NULL)
+            return NO_WORD;
+        self->capacity = INITIAL_DICTIONARY_SIZE;
+    }
+
+    size_t j = findSlot(self, word, length, hash);
+    if (self->slots[j] != 0)
+        return self->slots[j] - 1;
+
+    if (self->size == self->allocated && !allocateSegment(self))
+        return NO_WORD;
+
+    // keep load factor below 1/2, new table is filled before the old one
+    // is freed
+    if (2 * (self->size + 1) >= self->capacity) {
+        unsigned int *slots = rehash(self, self->capacity * 2);
+        if (slots == NULL)
+            return NO_WORD;
+        free(self->slots);
+        self->slots = slots;
+        self->capacity *= 2;
+        j = findSlot(self, word, length, hash);
+    }
+
+    Entry e = {word, length, hash};
+    if (!retained) {
+        char *copy = ArenaTryAlloc(&self->words, length);
+        if (copy == NULL)
+            return NO_WORD;
+        memcpy(copy, word, length);
+        e.word = copy;
+    }
+
+    unsigned int id = (unsigned int)self->size++;
+    *entry(self, id) = e;
+    self->slots[j] = id + 1;
+
+    return id;
+}
+
+static unsigned int intern(const char *word, size_t length, int retained) {
+    Dictionary *self = dictionary();
+    unsigned long long hash = hashBytes(word, length);
+    CachedWord *cached = &cache[hash & (WORD_CACHE_SIZE - 1)];
+
+    // words stored in arena never change, so they can be compared without
+    // lock, this thread has seen them under lock
+    if (cached->generation == self->generation && cached->length == length &&
+        memcmp(cached->word, word, length) == 0)
+        return cached->id;
+
+    pthread_mutex_lock(&self->lock);
+    unsigned int id = findOrInsert(self, word, length, hash, retained);
+    if (id == NO_WORD) {
+        pthread_mutex_unlock(&self->lock);
+        allocationFailed();
+    }
+    cached->word = entry(self, id)->word;
+    pthread_mutex_unlock(&self->lock);
+
+    cached->length = length;
+    cached->id = id;
+    cached->generation = self->generation;
+
+    return id;
+}
+
+unsigned int internWord(const char *word, size_t length) {
+    return intern(word, length, 0);
+}
+
+unsigned int internRetainedWord(const char *word, size_t length) {
+    return intern(word, length, 1);
+}
+
+void internRetainMapping(void *data, size_t size) {
+    Dictionary *self = dictionary();
+    pthread_mutex_lock(&self->lock);
+
+    if (self->mappingCount == self->mappingsAllocated) {
+        size_t allocated = self->mappingsAllocated == 0
+                           ? INITIAL_MAPPINGS_SIZE
+                           : self->mappingsAllocated * 2;
+        Mapping *mappings = realloc(self->mappings,
+                                    allocated * sizeof (Mapping));
+        if (mappings == NULL) {
+            pthread_mutex_unlock(&self->lock);
+            allocationFailed();
+        }
+        self->mappings = mappings;
+        self->mappingsAllocated = allocated;
+    }
+
+    Mapping m = {data, size};
+    self->mappings[self->mappingCount++] = m;
+
+    pthread_mutex_unlock(&self->lock);
+}
+
+StringView internedWord(unsigned int id) {
+    const Entry *e = entry(dictionary(), id);
+    StringView view = {e->word, e->length};
+    return view;
+}
+
+unsigned long long internedHash(unsigned int id) {
+    return entry(dictionary(), id)->hash;
+}
+
+size_t internMemory() {
+    const Dictionary *self = dictionary();
+    return self->capacity * sizeof (unsigned int) +
+           self->allocated * sizeof (Entry) +
+           self->words.allocated;
+}
+
+// frees all words of dictionary and leaves it empty
+static void clear(Dictionary *self) {
+    ArenaFree(&self->words);
+    free(self->slots);
+    for (int i = 0; i < SEGMENTS; ++i) {
+        free(self->segments[i]);
+        self->segments[i] = NULL;
+    }
+    for (size_t i = 0; i < self->mappingCount; ++i) {
+        munmap(self->mappings[i].data, self->mappings[i].size);
+    }
+    free(self->mappings);
+    self->mappings = NULL;
+    self->mappingCount = 0;
+    self->mappingsAllocated = 0;
+    self->slots = NULL;
+    self->capacity = 0;
+    self->size = 0;
+    self->allocated = 0;
+    self->generation = atomic_fetch_add(&lastGeneration, 1) + 1;
+}
+
+void internFree() {
+    clear(dictionary());
+}
+
+Dictionary *DictionaryNew() {
+    Dictionary *self = calloc(1, sizeof (Dictionary));
+    if (self == NULL)
+        return NULL;
+    if (pthread_mutex_init(&self->lock, NULL) != 0) {
+        free(self);
+        return NULL;
+    }
+    self->generation = atomic_fetch_add(&lastGeneration, 1) + 1;
+    return self;
+}
+
+void DictionaryFree(Dictionary *self) {
+    if (self == NULL)
+        return;
+    clear(self);
+    pthread_mutex_destroy(&self->lock);
+    free(self);
+}
+
+Dictionary *internDictionary() {
+    return current;
+}
+
+void internUse(Dictionary *self) {
+    current = self;
+}
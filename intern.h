@@ -0,0 +1,66 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides dictionaries of words. Each distinct word gets
+ *   its own id, ids are consecutive numbers starting from 0, so two words are
+ *   equal if and only if their ids are equal. Each distinct word is stored
+ *   only once. Words of mapped input handed over to dictionary aren't
+ *   copied at all, dictionary points at them.
+ *   Functions intern* act on dictionary chosen by the calling thread with
+ *   internUse, or on global dictionary if it didn't choose any.
+ *   internWord, internedWord and internedHash can be called from many
+ *   threads at once, the last two with ids returned to the same thread or
+ *   passed to it after that. Other functions can't be called while words
+ *   are interned.
+ */
+
+#ifndef SIMILAR_LINES_INTERN_H
+#define SIMILAR_LINES_INTERN_H
+
+#include <stdlib.h>
+
+typedef struct Dictionary Dictionary;
+
+// word given by its bytes, it isn't ended by '\0'
+typedef struct {
+    const char *data;
+    size_t length;
+} StringView;
+
+// returns id of given word, adds its copy to dictionary if it isn't there
+// yet
+unsigned int internWord(const char *word, size_t length);
+
+// like internWord, but word has to stay valid and unchanged until
+// internFree, so dictionary doesn't copy it
+unsigned int internRetainedWord(const char *word, size_t length);
+
+// hands mapped memory over to dictionary, which unmaps it in internFree,
+// so its words can be interned by internRetainedWord
+void internRetainMapping(void *data, size_t size);
+
+// returns word with given id
+StringView internedWord(unsigned int id);
+
+// returns hash of word with given id, it depends only on content of word
+unsigned long long internedHash(unsigned int id);
+
+// returns approximate number of bytes used by dictionary
+size_t internMemory();
+
+// frees all words and retained mappings, dictionary can be used again
+void internFree();
+
+// returns new empty dictionary, NULL if there is no memory
+Dictionary *DictionaryNew();
+
+// frees dictionary with all its words and retained mappings
+void DictionaryFree(Dictionary *self);
+
+// returns dictionary used by calling thread, NULL means global one
+Dictionary *internDictionary();
+
+// makes calling thread use given dictionary, NULL means global one
+void internUse(Dictionary *self);
+
+#endif //SIMILAR_LINES_INTERN_H
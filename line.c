@@ -1,29 +1,158 @@
-/**
- * Author:  Mateusz Malinowski
- * Date:    March 2021
- */
-
-#include "line.h"
-#include "vector.h"
-
-Line *LineNew(int nr) {
-    Line *obj = malloc(sizeof (Line));
-    if (obj == NULL) {
-        exit(1);
-    }
-
-    obj->ullv = ULLVectorNew();
-    obj->llv = LLVectorNew();
-    obj->dv = DVectorNew();
-    obj->sv = SVectorNew();
-    obj->nr = nr;
-
-    return obj;
-}
-
-void LineFree(Line *self) {
-    ULLVectorFree(&self->ullv);
-    LLVectorFree(&self->llv);
-    DVectorFree(&self->dv);
-    SVectorFree(&self->sv);
-}
\ No newline at end of file
+/**
+ * Author:  Mateusz Malinowski
+ * Date:    March 2021
+ */
+
+#include "line.h"
+
+#include "alloc.h"
+#include "arena.h"
+#include "vector.h"
+
+#include <string.h>
+
+Line *LineNew(int nr) {
+    Line *obj = malloc(sizeof (Line));
+    if (obj == NULL) {
+        allocationFailed();
+    }
+
+    obj->ullv = ULLVectorNew();
+    obj->llv = LLVectorNew();
+    obj->dv = DVectorNew();
+    obj->sv = SVectorNew();
+    obj->nr = nr;
+    obj->key = NULL;
+    obj->keyLength = 0;
+    obj->keyPrefix = 0;
+
+    return obj;
+}
+
+void LineFree(Line *self) {
+    ULLVectorFree(&self->ullv);
+    LLVectorFree(&self->llv);
+    DVectorFree(&self->dv);
+    SVectorFree(&self->sv);
+}
+void LineClear(Line *self) {
+    self->ullv.size = 0;
+    self->llv.size = 0;
+    self->dv.size = 0;
+    self->sv.size = 0;
+}
+
+// copies n items of given size into arena
+static void *copyItems(const void *items, size_t n, size_t size,
+                       Arena *arena) {
+    void *copy = ArenaAlloc(arena, n * size);
+    memcpy(copy, items, n * size);
+    return copy;
+}
+
+// elements which fit into vectors stay inline, others are copied into arena,
+// so the copy doesn't own any memory
+Line LineCopy(const Line *self, Arena *arena) {
+    Line obj = *self;
+
+    if (self->ullv.size <= ULL_INLINE_SIZE) {
+        memcpy(obj.ullv.local, ULLVectorItems(&self->ullv),
+               self->ullv.size * sizeof (unsigned long long));
+        obj.ullv.allocated = 0;
+    } else {
+        obj.ullv.heap = copyItems(self->ullv.heap, self->ullv.size,
+                                  sizeof (unsigned long long), arena);
+        obj.ullv.allocated = obj.ullv.size;
+    }
+
+    if (self->llv.size <= LL_INLINE_SIZE) {
+        memcpy(obj.llv.local, LLVectorItems(&self->llv),
+               self->llv.size * sizeof (long long));
+        obj.llv.allocated = 0;
+    } else {
+        obj.llv.heap = copyItems(self->llv.heap, self->llv.size,
+                                 sizeof (long long), arena);
+        obj.llv.allocated = obj.llv.size;
+    }
+
+    if (self->dv.size <= D_INLINE_SIZE) {
+        memcpy(obj.dv.local, DVectorItems(&self->dv),
+               self->dv.size * sizeof (double));
+        obj.dv.allocated = 0;
+    } else {
+        obj.dv.heap = copyItems(self->dv.heap, self->dv.size,
+                                sizeof (double), arena);
+        obj.dv.allocated = obj.dv.size;
+    }
+
+    if (self->sv.size <= S_INLINE_SIZE) {
+        memcpy(obj.sv.local, SVectorItems(&self->sv),
+               self->sv.size * sizeof (unsigned int));
+        obj.sv.allocated = 0;
+    } else {
+        obj.sv.heap = copyItems(self->sv.heap, self->sv.size,
+                                sizeof (unsigned int), arena);
+        obj.sv.allocated = obj.sv.size;
+    }
+
+    return obj;
+}
+
+// every element is preceded by byte 1 and each of four vectors is ended by 0
+size_t LineKeyLength(const Line *self) {
+    return (1 + sizeof (unsigned long long)) * (self->ullv.size +
+                                                self->llv.size +
+                                                self->dv.size) +
+           (1 + sizeof (unsigned int)) * self->sv.size + 4;
+}
+
+// writes number as big-endian, returns position after it
+static unsigned char *writeNumber(unsigned char *key, unsigned long long x,
+                                  int bytes) {
+    *key++ = 1;
+    for (int i = bytes - 1; i >= 0; --i) {
+        *key++ = (unsigned char)(x >> (8 * i));
+    }
+    return key;
+}
+
+void LineWriteKey(Line *self, unsigned char *key) {
+    static const unsigned long long SIGN_BIT = 1ULL << 63;
+    const unsigned long long *ulls = ULLVectorItems(&self->ullv);
+    const long long *lls = LLVectorItems(&self->llv);
+    const double *ds = DVectorItems(&self->dv);
+    const unsigned int *ids = SVectorItems(&self->sv);
+    unsigned char *p = key;
+
+    for (size_t i = 0; i < self->ullv.size; ++i) {
+        p = writeNumber(p, ulls[i], 8);
+    }
+    *p++ = 0;
+
+    for (size_t i = 0; i < self->llv.size; ++i) {
+        p = writeNumber(p, (unsigned long long)lls[i] ^ SIGN_BIT, 8);
+    }
+    *p++ = 0;
+
+    // the same order preserving transformation as in sort.c
+    for (size_t i = 0; i < self->dv.size; ++i) {
+        unsigned long long bits;
+        memcpy(&bits, &ds[i], sizeof bits);
+        p = writeNumber(p, (bits & SIGN_BIT) ? ~bits : bits ^ SIGN_BIT, 8);
+    }
+    *p++ = 0;
+
+    for (size_t i = 0; i < self->sv.size; ++i) {
+        p = writeNumber(p, ids[i], 4);
+    }
+    *p++ = 0;
+
+    self->key = key;
+    self->keyLength = (size_t)(p - key);
+    self->keyPrefix = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        self->keyPrefix <<= 8;
+        if (i < self->keyLength)
+            self->keyPrefix |= key[i];
+    }
+}
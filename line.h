@@ -1,27 +1,51 @@
-/**
- * Author:  Mateusz Malinowski
- * Date:    March 2021
- *
- * Summary of File:
- *
- *   This header provides Line structure and basic functions to create and
- *   delete object of this structure.
- */
-
-#ifndef SIMILAR_LINES_LINE_H
-#define SIMILAR_LINES_LINE_H
-
-#include "vector.h"
-
-typedef struct {
-    ULLVector ullv;
-    LLVector llv;
-    DVector dv;
-    SVector sv;
-    int nr;
-} Line;
-
-Line *LineNew(int nr);
-void LineFree(Line *self);
-
-#endif //SIMILAR_LINES_LINE_H
+/**
+ * Author:  Mateusz Malinowski
+ * Date:    March 2021
+ *
+ * Summary of File:
+ *
+ *   This header provides Line structure and basic functions to create and
+ *   delete object of this structure.
+ *   Line can own its vectors or its vectors can be stored in an arena, then
+ *   the line must not be freed nor changed in size.
+ *   Line with sorted elements can be turned into canonical key. Key is a
+ *   sequence of bytes, such that memcmp of keys gives the same order as
+ *   comparing vectors of lines one by one. Each vector is written as
+ *   elements preceded by byte 1 and ended by byte 0, elements are written
+ *   as big-endian unsigned numbers with the same order as elements.
+ */
+
+#ifndef SIMILAR_LINES_LINE_H
+#define SIMILAR_LINES_LINE_H
+
+#include "arena.h"
+#include "vector.h"
+
+typedef struct {
+    ULLVector ullv;
+    LLVector llv;
+    DVector dv;
+    SVector sv;
+    int nr;
+    const unsigned char *key;       // NULL if key wasn't written
+    size_t keyLength;
+    unsigned long long keyPrefix;   // first 8 bytes of key as a number
+} Line;
+
+Line *LineNew(int nr);
+void LineFree(Line *self);
+
+// removes all elements, but keeps allocated memory for next line
+void LineClear(Line *self);
+
+// returns copy of line which vectors are stored in the arena
+Line LineCopy(const Line *self, Arena *arena);
+
+// returns length of key of line
+size_t LineKeyLength(const Line *self);
+
+// writes key of line with sorted elements into given buffer of size
+// LineKeyLength() and sets it as key of line
+void LineWriteKey(Line *self, unsigned char *key);
+
+#endif //SIMILAR_LINES_LINE_H
@@ -1,45 +1,78 @@
-/**
- * Author:  Mateusz Malinowski
- * Date:    March 2021
- *
- * Summary of File:
- *
- *   This file implements basic line vector functions.
- */
-
-#include "lineVector.h"
-
-#include "line.h"
-
-#include <stdio.h>
-
-LineVector LineVectorNew() {
-    LineVector obj = {NULL, 0, 0};
-    return obj;
-}
-
-void LineVectorFree(LineVector *self) {
-    for (size_t i = 0; i < self->size; ++i) {
-        LineFree(&self->items[i]);
-    }
-    free(self->items);
-}
-
-void LineVectorPush(LineVector *self, Line line) {
-    size_t typeSize = sizeof line;
-    if (self->allocated == 0) {
-        self->items = malloc(typeSize);
-        if (self->items == NULL) {
-            exit(1);
-        }
-        self->allocated = 1;
-    } else if (self->size == self->allocated) {
-        self->items = realloc(self->items, self->allocated * 2 * typeSize);
-        if (self->items == NULL) {
-            exit(1);
-        }
-        self->allocated *= 2;
-    }
-
-    self->items[self->size++] = line;
-}
\ No newline at end of file
+/**
+ * Author:  Mateusz Malinowski
+ * Date:    March 2021
+ *
+ * Summary of File:
+ *
+ *   This file implements basic line vector functions.
+ */
+
+#include "lineVector.h"
+
+#include "alloc.h"
+#include "arena.h"
+#include "line.h"
+
+#include <stdio.h>
+#include <string.h>
+
+LineVector LineVectorNew() {
+    LineVector obj = {NULL, 0, 0, ArenaNew()};
+    return obj;
+}
+
+void LineVectorFree(LineVector *self) {
+    free(self->items);
+    ArenaFree(&self->arena);
+}
+
+void LineVectorClear(LineVector *self) {
+    self->size = 0;
+    ArenaFree(&self->arena);
+    self->arena = ArenaNew();
+}
+
+void LineVectorPush(LineVector *self, const Line *line) {
+    size_t typeSize = sizeof *line;
+    if (self->allocated == 0) {
+        self->items = malloc(typeSize);
+        if (self->items == NULL) {
+            allocationFailed();
+        }
+        self->allocated = 1;
+    } else if (self->size == self->allocated) {
+        Line *items = realloc(self->items, self->allocated * 2 * typeSize);
+        if (items == NULL) {
+            allocationFailed();
+        }
+        self->items = items;
+        self->allocated *= 2;
+    }
+
+    self->items[self->size++] = LineCopy(line, &self->arena);
+}
+void LineVectorAppend(LineVector *self, LineVector *other) {
+    size_t size = self->size + other->size;
+
+    // vector grows at least twice, so many appends take linear time
+    if (size > self->allocated) {
+        size_t allocated = self->allocated * 2 > size ? self->allocated * 2
+                                                      : size;
+        Line *items = realloc(self->items, allocated * sizeof (Line));
+        if (items == NULL) {
+            allocationFailed();
+        }
+        self->items = items;
+        self->allocated = allocated;
+    }
+
+    if (other->size > 0) {
+        memcpy(self->items + self->size, other->items,
+               other->size * sizeof (Line));
+    }
+    self->size = size;
+    ArenaMerge(&self->arena, &other->arena);
+
+    free(other->items);
+    *other = LineVectorNew();
+}
@@ -1,25 +1,37 @@
-/**
- * Author:  Mateusz Malinowski
- * Date:    March 2021
- *
- * Summary of File:
- *
- *   This header provides line vector structure and basic functions.
- */
-
-#ifndef SIMILAR_LINES_LINEVECTOR_H
-#define SIMILAR_LINES_LINEVECTOR_H
-
-#include "line.h"
-
-typedef struct {
-    Line *items;
-    size_t size;
-    size_t allocated;
-} LineVector;
-
-LineVector LineVectorNew();
-void LineVectorFree(LineVector *self);
-void LineVectorPush(LineVector *self, Line line);
-
-#endif //SIMILAR_LINES_LINEVECTOR_H
+/**
+ * Author:  Mateusz Malinowski
+ * Date:    March 2021
+ *
+ * Summary of File:
+ *
+ *   This header provides line vector structure and basic functions.
+ *   Vectors of all pushed lines are stored in arena of line vector, so they
+ *   are freed at once.
+ */
+
+#ifndef SIMILAR_LINES_LINEVECTOR_H
+#define SIMILAR_LINES_LINEVECTOR_H
+
+#include "arena.h"
+#include "line.h"
+
+typedef struct {
+    Line *items;
+    size_t size;
+    size_t allocated;
+    Arena arena;
+} LineVector;
+
+LineVector LineVectorNew();
+void LineVectorFree(LineVector *self);
+
+// removes all lines, memory of items is kept for next lines
+void LineVectorClear(LineVector *self);
+
+// pushes copy of line, given line stays unchanged
+void LineVectorPush(LineVector *self, const Line *line);
+
+// moves all lines of other vector at the end of self, other becomes empty
+void LineVectorAppend(LineVector *self, LineVector *other);
+
+#endif //SIMILAR_LINES_LINEVECTOR_H
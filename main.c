@@ -5,68 +5,110 @@
  * Summary of File:
  *
  *   This file contains main function which finds similar lines and prints
- *   result. Idea of the algorithm is to sort all lines. After that similar
- *   lines are next to each other, so we can easily group them. Then we sort
- *   groups of line numbers and print it.
+ *   result. By default idea of the algorithm is to sort all lines. After that
+ *   similar lines are next to each other, so we can easily group them. Then
+ *   we sort groups of line numbers and print it.
  *   Complexity of this solution is O(n*log(n)*cmp_t), where n is number of
  *   lines and cmp_t is comparison time which is proportional to length of
  *   compared lines.
+ *   With option "-g hash" lines are grouped in hash table by their
+ *   fingerprints instead, which is expected to be linear in size of input.
+ *   With option "-g approx" also almost similar lines are grouped (see
+ *   approx.h).
+ *   With option "-s" lines are grouped while they are read (see stream.h).
+ *   With option "-m" lines are sorted in temporary files (see external.h).
+ *   With option "-b" many files are processed separately (see batch.h).
+ *   With options "-i" and "-q" classes are kept in index (see index.h).
  */
 
-#include "compare.h"
+#include "approx.h"
+#include "batch.h"
+#include "external.h"
+#include "group.h"
+#include "index.h"
+#include "intern.h"
 #include "lineVector.h"
+#include "options.h"
+#include "output.h"
 #include "readInput.h"
+#include "stats.h"
+#include "stream.h"
 #include "vector.h"
 
 #include <stdio.h>
 
-static void printAnswer(ULLVectorVector *v) {
-    for (size_t i = 0; i < v->size; ++i) {
-        // in order to not print space at end of line
-        printf("%llu", v->items[i].items[0]);
-        for (size_t j = 1; j < v->items[i].size; ++j) {
-            printf(" %llu", v->items[i].items[j]);
-        }
-        printf("\n");
-    }
+static void printAnswer(ULLVectorVector *v, int threads) {
+    Writer writer = WriterNew(fileno(stdout));
+    writeGroups(&writer, v, threads);
+    WriterFree(&writer);
 }
 
-int main() {
-    LineVector lines = LineVectorNew();
+int main(int argc, char *argv[]) {
+    Options options = parseOptions(argc, argv);
+
+    if (options.stats)
+        statsStart(options.statsFile);
+
+    if (options.stream) {
+        statsPhase("stream");
+        findSimilarInStream(&options);
+        statsReport();
+        internFree();
+        return 0;
+    }
+
+    if (options.memoryLimit > 0) {
+        findSimilarExternally(&options);
+        statsReport();
+        return 0;
+    }
 
-    readInput(&lines);
+    if (options.buildIndex != NULL || options.queryIndex != NULL) {
+        if (options.buildIndex != NULL)
+            buildIndex(&options);
+        else
+            queryIndex(&options);
+        statsReport();
+        internFree();
+        return 0;
+    }
 
-    sortLineVector(&lines);
+    if (options.batch) {
+        statsPhase("batch");
+        int failed = findSimilarInFiles(&options);
+        statsReport();
+        internFree();
+        return failed > 0 ? 1 : 0;
+    }
 
-    if (lines.size > 0) {
-        ULLVectorVector answer = ULLVectorVectorNew();
-        ULLVector similarLines = ULLVectorNew();
-        Line *lastLine = NULL;
+    LineVector lines = LineVectorNew();
 
-        ULLVectorPush(&similarLines, lines.items[0].nr);
-        lastLine = &lines.items[0];
+    statsPhase("read");
+    Writer errors = WriterNew(fileno(stderr));
+    // words point into mapped input until dictionary is freed
+    readInput(fileno(stdin), &lines, options.threads, 1, &errors);
+    WriterFree(&errors);
 
-        for (size_t i = 1; i < lines.size; ++i) {
-            if (isSimilar(lastLine, &lines.items[i]) == 0) {
-                ULLVectorPush(&similarLines, lines.items[i].nr);
-            }
-            else {
-                ULLVectorVectorPush(&answer, similarLines);
-                similarLines = ULLVectorNew();
-                ULLVectorPush(&similarLines, lines.items[i].nr);
-                lastLine = &lines.items[i];
-            }
-        }
-        ULLVectorVectorPush(&answer, similarLines); // push last group
+    ULLVectorVector answer = ULLVectorVectorNew();
 
-        sortULLVectorVector(&answer);
+    if (options.grouping == GROUP_BY_HASHING)
+        groupByHashing(&lines, options.threads, &answer);
+    else if (options.grouping == GROUP_APPROXIMATELY)
+        groupApproximately(&lines, options.threads, options.threshold,
+                           &answer);
+    else
+        groupBySorting(&lines, options.threads, &answer);
 
-        printAnswer(&answer);
+    statsPhase("print");
+    printAnswer(&answer, options.threads);
 
-        ULLVectorVectorFree(&answer);
-    }
+    statsPhase("free");
 
+    ULLVectorVectorFree(&answer);
     LineVectorFree(&lines);
+    internFree();
+
+    statsReport();
 
     return 0;
 }
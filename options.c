@@ -0,0 +1,222 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements reading program options from command line arguments.
+ */
+
+#include "options.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const unsigned long long MAX_THREADS = 1024;
+
+const double DEFAULT_THRESHOLD = 0.8;
+
+// external-memory mode needs buffers of reader, writer and run files
+const unsigned long long MIN_MEMORY_LIMIT = 4 << 20;
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s [-g sort|hash|approx] [-J threshold] "
+                    "[-j threads] [--stats[=file]]\n"
+                    "       %s -s [-p seconds] [-w lines] [-W seconds] "
+                    "[--stats[=file]]\n"
+                    "       %s -m size [-T dir] [--stats[=file]]\n"
+                    "       %s -b [-g sort|hash|approx] [-J threshold] "
+                    "[-j threads] [-o dir] [--stats[=file]] [file...]\n"
+                    "       %s -i index|-q index [--stats[=file]]\n",
+            program, program, program, program, program);
+    exit(2);
+}
+
+// returns value of option at argv[*i], moves *i to the last used argument
+static const char *optionValue(int argc, char *argv[], int *i) {
+    if (*i + 1 >= argc)
+        usage(argv[0]);
+    return argv[++*i];
+}
+
+// returns value of option at argv[*i] which has to be number from 1 to max
+static unsigned long long numberValue(int argc, char *argv[], int *i,
+                                      unsigned long long max) {
+    const char *value = optionValue(argc, argv, i);
+    char *end = NULL;
+
+    errno = 0;
+    unsigned long long number = strtoull(value, &end, 10);
+    if (errno != 0 || *end != '\0' || value[0] == '-' || number == 0 ||
+        number > max)
+        usage(argv[0]);
+
+    return number;
+}
+
+// returns value of option at argv[*i] which has to be positive number of
+// bytes, optionally followed by K, M or G
+static unsigned long long sizeValue(int argc, char *argv[], int *i) {
+    const char *value = optionValue(argc, argv, i);
+    char *end = NULL;
+
+    errno = 0;
+    unsigned long long size = strtoull(value, &end, 10);
+    if (errno != 0 || end == value || value[0] == '-' || size == 0)
+        usage(argv[0]);
+
+    int shift = 0;
+    if (*end == 'K' || *end == 'k')
+        shift = 10;
+    else if (*end == 'M' || *end == 'm')
+        shift = 20;
+    else if (*end == 'G' || *end == 'g')
+        shift = 30;
+    if (shift > 0)
+        end++;
+
+    if (*end != '\0' || size > (ULLONG_MAX >> shift))
+        usage(argv[0]);
+
+    return size << shift;
+}
+
+// returns value of option at argv[*i] which has to be positive number
+static double secondsValue(int argc, char *argv[], int *i) {
+    const char *value = optionValue(argc, argv, i);
+    char *end = NULL;
+
+    errno = 0;
+    double seconds = strtod(value, &end);
+    if (errno != 0 || *end != '\0' || !(seconds > 0))
+        usage(argv[0]);
+
+    return seconds;
+}
+
+// returns value of option at argv[*i] which has to be number from (0, 1]
+static double fractionValue(int argc, char *argv[], int *i) {
+    const char *value = optionValue(argc, argv, i);
+    char *end = NULL;
+
+    errno = 0;
+    double fraction = strtod(value, &end);
+    if (errno != 0 || *end != '\0' || !(fraction > 0 && fraction <= 1))
+        usage(argv[0]);
+
+    return fraction;
+}
+
+Options parseOptions(int argc, char *argv[]) {
+    Options obj = {GROUP_BY_SORTING, 0, 0, 0, 0, 0, 0, 0, NULL, 0, NULL, 0,
+                   NULL, NULL, NULL, 0, NULL};
+    int grouped = 0;    // set if grouping was chosen by option
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-g") == 0) {
+            const char *value = optionValue(argc, argv, &i);
+            grouped = 1;
+            if (strcmp(value, "sort") == 0)
+                obj.grouping = GROUP_BY_SORTING;
+            else if (strcmp(value, "hash") == 0)
+                obj.grouping = GROUP_BY_HASHING;
+            else if (strcmp(value, "approx") == 0)
+                obj.grouping = GROUP_APPROXIMATELY;
+            else
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "-J") == 0) {
+            obj.threshold = fractionValue(argc, argv, &i);
+        }
+        else if (strcmp(argv[i], "-j") == 0) {
+            obj.threads = (int)numberValue(argc, argv, &i, MAX_THREADS);
+        }
+        else if (strcmp(argv[i], "-s") == 0) {
+            obj.stream = 1;
+        }
+        else if (strcmp(argv[i], "-p") == 0) {
+            obj.snapshotInterval = secondsValue(argc, argv, &i);
+        }
+        else if (strcmp(argv[i], "-w") == 0) {
+            obj.windowLines = numberValue(argc, argv, &i, ULLONG_MAX);
+        }
+        else if (strcmp(argv[i], "-W") == 0) {
+            obj.windowSeconds = secondsValue(argc, argv, &i);
+        }
+        else if (strcmp(argv[i], "-m") == 0) {
+            obj.memoryLimit = sizeValue(argc, argv, &i);
+            if (obj.memoryLimit < MIN_MEMORY_LIMIT)
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "-T") == 0) {
+            obj.tempDir = optionValue(argc, argv, &i);
+        }
+        else if (strcmp(argv[i], "-b") == 0) {
+            obj.batch = 1;
+        }
+        else if (strcmp(argv[i], "-o") == 0) {
+            obj.outputDir = optionValue(argc, argv, &i);
+        }
+        else if (strcmp(argv[i], "-i") == 0) {
+            obj.buildIndex = optionValue(argc, argv, &i);
+        }
+        else if (strcmp(argv[i], "-q") == 0) {
+            obj.queryIndex = optionValue(argc, argv, &i);
+        }
+        else if (strcmp(argv[i], "--stats") == 0) {
+            obj.stats = 1;
+        }
+        else if (strncmp(argv[i], "--stats=", 8) == 0 && argv[i][8] != '\0') {
+            obj.stats = 1;
+            obj.statsFile = argv[i] + 8;
+        }
+        else if (argv[i][0] != '-') {
+            // files are moved in place of already read arguments, so they
+            // stay in order without copying
+            if (obj.fileCount == 0)
+                obj.files = argv + i;
+            obj.files[obj.fileCount++] = argv[i];
+        }
+        else {
+            usage(argv[0]);
+        }
+    }
+
+    // threshold is used only by approximate grouping, which needs all lines
+    if ((obj.threshold > 0 && obj.grouping != GROUP_APPROXIMATELY) ||
+        (obj.grouping == GROUP_APPROXIMATELY &&
+         (obj.stream || obj.memoryLimit > 0)))
+        usage(argv[0]);
+    if (obj.threshold == 0)
+        obj.threshold = DEFAULT_THRESHOLD;
+
+    // streaming mode works on one thread with its own grouping
+    if (obj.stream && (grouped || obj.threads > 0))
+        usage(argv[0]);
+    if (obj.threads == 0)
+        obj.threads = 1;
+
+    // these options make sense only in streaming mode
+    if (!obj.stream && (obj.snapshotInterval > 0 || obj.windowLines > 0 ||
+                        obj.windowSeconds > 0))
+        usage(argv[0]);
+
+    // external-memory mode can't stream
+    if ((obj.stream && obj.memoryLimit > 0) ||
+        (obj.tempDir != NULL && obj.memoryLimit == 0))
+        usage(argv[0]);
+
+    // files and output directory are used only in batch mode, which
+    // processes whole files
+    if ((!obj.batch && (obj.fileCount > 0 || obj.outputDir != NULL)) ||
+        (obj.batch && (obj.stream || obj.memoryLimit > 0)))
+        usage(argv[0]);
+
+    // index modes read only stdin and don't group lines
+    if ((obj.buildIndex != NULL || obj.queryIndex != NULL) &&
+        ((obj.buildIndex != NULL && obj.queryIndex != NULL) || obj.stream ||
+         obj.memoryLimit > 0 || obj.batch))
+        usage(argv[0]);
+
+    return obj;
+}
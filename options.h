@@ -0,0 +1,68 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides structure with program options and function which
+ *   reads them from command line arguments.
+ *   Supported options:
+ *    -g sort|hash|approx
+ *                  algorithm used to group similar lines (default sort),
+ *                  approx groups also almost similar lines (see approx.h)
+ *    -J THRESHOLD  in approx grouping minimal Jaccard index of joined
+ *                  lines, from 0 to 1 (default 0.8)
+ *    -j N          number of threads (default 1)
+ *    -s            streaming mode, groups are found while lines are read
+ *                  by one thread, so -g and -j can't be used with it
+ *    -p SECONDS    in streaming mode print groups every SECONDS seconds
+ *    -w N          in streaming mode keep only lines from last N lines of
+ *                  input
+ *    -W SECONDS    in streaming mode keep only lines from last SECONDS
+ *                  seconds
+ *    -m SIZE       external-memory mode, use about SIZE bytes of memory
+ *                  (suffix K, M or G may be used, at least 4M), the rest
+ *                  is kept in temporary files
+ *    -T DIR        directory of temporary files (default $TMPDIR or /tmp)
+ *    -b [FILE...]  batch mode, each of given files is processed separately,
+ *                  if no file is given, paths are read from stdin one per
+ *                  line
+ *    -o DIR        in batch mode write result of each file into DIR
+ *                  instead of one framed stream on stdout
+ *    -i FILE       build index of classes of input lines in FILE
+ *    -q FILE       print class in index FILE of each input line
+ *    --stats[=FILE] print time of phases, numbers of lines and tokens,
+ *                  allocations and peak memory to stderr or FILE
+ */
+
+#ifndef SIMILAR_LINES_OPTIONS_H
+#define SIMILAR_LINES_OPTIONS_H
+
+typedef enum {
+    GROUP_BY_SORTING,
+    GROUP_BY_HASHING,
+    GROUP_APPROXIMATELY
+} groupingMode;
+
+typedef struct {
+    groupingMode grouping;
+    double threshold;               // used by approximate grouping
+    int threads;
+    int stream;
+    double snapshotInterval;        // 0 if groups are printed only at end
+    unsigned long long windowLines; // 0 if number of lines isn't limited
+    double windowSeconds;           // 0 if age of lines isn't limited
+    unsigned long long memoryLimit; // 0 if all lines are kept in memory
+    const char *tempDir;            // NULL if default directory is used
+    int batch;
+    char **files;                   // files given in batch mode
+    int fileCount;
+    const char *outputDir;          // NULL if results go to stdout
+    const char *buildIndex;         // NULL if index isn't built
+    const char *queryIndex;         // NULL if index isn't queried
+    int stats;
+    const char *statsFile;          // NULL if statistics go to stderr
+} Options;
+
+// reads options from command line arguments
+// on invalid arguments prints usage and exits with code 2
+Options parseOptions(int argc, char *argv[]);
+
+#endif //SIMILAR_LINES_OPTIONS_H
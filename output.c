@@ -0,0 +1,235 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements writer described in related header. Numbers are
+ *   converted two digits at a time from the end. Many groups are split into
+ *   parts of similar number of line numbers, a batch of parts is formatted
+ *   in parallel and written in order before the next batch, so memory used
+ *   by writers of threads doesn't depend on size of result.
+ */
+
+#include "output.h"
+
+#include "alloc.h"
+#include "parallel.h"
+#include "vector.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+const size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+// line numbers in one part formatted by one thread
+static const size_t PART_NUMBERS = 1 << 16;
+
+// the longest unsigned long long has 20 digits
+#define MAX_NUMBER_LENGTH 20
+
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233"
+    "34353637383940414243444546474849505152535455565758596061626364656667"
+    "6869707172737475767778798081828384858687888990919293949596979899";
+
+Writer WriterNew(int fd) {
+    Writer obj = {NULL, 0, 0, fd};
+
+    if (fd >= 0) {
+        obj.buffer = malloc(WRITE_BUFFER_SIZE);
+        if (obj.buffer == NULL) {
+            allocationFailed();
+        }
+        obj.allocated = WRITE_BUFFER_SIZE;
+    }
+
+    return obj;
+}
+
+void WriterFree(Writer *self) {
+    WriterFlush(self);
+    free(self->buffer);
+}
+
+// writes all bytes to file descriptor, retries interrupted writes
+static void writeAll(int fd, const char *data, size_t length) {
+    size_t written = 0;
+
+    while (written < length) {
+        ssize_t res = write(fd, data + written, length - written);
+        if (res < 0 && errno == EINTR)
+            continue;
+        if (res <= 0) // output is lost as with failed printf
+            break;
+        written += (size_t)res;
+    }
+}
+
+void WriterFlush(Writer *self) {
+    if (self->fd < 0)
+        return;
+
+    writeAll(self->fd, self->buffer, self->size);
+    self->size = 0;
+}
+
+// makes room for n more bytes, writer with file descriptor is flushed
+// instead of growing if possible
+static void reserve(Writer *self, size_t n) {
+    if (self->size + n <= self->allocated)
+        return;
+
+    if (self->fd >= 0) {
+        WriterFlush(self);
+        if (n <= self->allocated)
+            return;
+    }
+
+    size_t allocated = self->allocated == 0 ? WRITE_BUFFER_SIZE
+                                            : self->allocated * 2;
+    while (allocated < self->size + n) {
+        allocated *= 2;
+    }
+
+    self->buffer = realloc(self->buffer, allocated);
+    if (self->buffer == NULL) {
+        allocationFailed();
+    }
+    self->allocated = allocated;
+}
+
+void WriterChar(Writer *self, char c) {
+    reserve(self, 1);
+    self->buffer[self->size++] = c;
+}
+
+void WriterBytes(Writer *self, const char *data, size_t length) {
+    reserve(self, length);
+    memcpy(self->buffer + self->size, data, length);
+    self->size += length;
+}
+
+// writes number without checking space, returns number of written bytes
+static size_t formatNumber(char *out, unsigned long long x) {
+    char digits[MAX_NUMBER_LENGTH];
+    char *p = digits + MAX_NUMBER_LENGTH;
+
+    while (x >= 100) {
+        unsigned i = (unsigned)(x % 100) * 2;
+        x /= 100;
+        *--p = DIGIT_PAIRS[i + 1];
+        *--p = DIGIT_PAIRS[i];
+    }
+    if (x >= 10) {
+        *--p = DIGIT_PAIRS[x * 2 + 1];
+        *--p = DIGIT_PAIRS[x * 2];
+    }
+    else {
+        *--p = (char)('0' + x);
+    }
+
+    size_t length = (size_t)(digits + MAX_NUMBER_LENGTH - p);
+    memcpy(out, p, length);
+    return length;
+}
+
+void WriterNumber(Writer *self, unsigned long long x) {
+    reserve(self, MAX_NUMBER_LENGTH);
+    self->size += formatNumber(self->buffer + self->size, x);
+}
+
+void WriterAppend(Writer *self, const Writer *other) {
+    // large output isn't copied
+    if (self->fd >= 0 && other->size > self->allocated) {
+        WriterFlush(self);
+        writeAll(self->fd, other->buffer, other->size);
+        return;
+    }
+
+    reserve(self, other->size);
+    memcpy(self->buffer + self->size, other->buffer, other->size);
+    self->size += other->size;
+}
+
+// writes groups [begin, end)
+static void writeRange(Writer *self, const ULLVectorVector *groups,
+                       size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        const ULLVector *group = &groups->items[i];
+        const unsigned long long *lines = ULLVectorItems(group);
+
+        // separator and number take at most MAX_NUMBER_LENGTH + 1 bytes
+        reserve(self, group->size * (MAX_NUMBER_LENGTH + 1));
+        char *out = self->buffer + self->size;
+
+        // in order to not print space at end of line
+        out += formatNumber(out, lines[0]);
+        for (size_t j = 1; j < group->size; ++j) {
+            *out++ = ' ';
+            out += formatNumber(out, lines[j]);
+        }
+        *out++ = '\n';
+
+        self->size = (size_t)(out - self->buffer);
+    }
+}
+
+// parts of one batch, part i consists of groups [bounds[i], bounds[i + 1])
+typedef struct {
+    const ULLVectorVector *groups;
+    const size_t *bounds;
+    Writer *writers;
+} Batch;
+
+static void writeParts(size_t begin, size_t end, void *arg) {
+    Batch *batch = arg;
+
+    for (size_t i = begin; i < end; ++i) {
+        batch->writers[i].size = 0;
+        writeRange(&batch->writers[i], batch->groups, batch->bounds[i],
+                   batch->bounds[i + 1]);
+    }
+}
+
+void writeGroups(Writer *self, const ULLVectorVector *groups, int threads) {
+    if (threads <= 1) {
+        writeRange(self, groups, 0, groups->size);
+        return;
+    }
+
+    size_t *bounds = malloc((threads + 1) * sizeof (size_t));
+    Writer *writers = malloc(threads * sizeof (Writer));
+    if (bounds == NULL || writers == NULL) {
+        allocationFailed();
+    }
+    for (int i = 0; i < threads; ++i) {
+        writers[i] = WriterNew(-1);
+    }
+
+    Batch batch = {groups, bounds, writers};
+    size_t next = 0;
+
+    while (next < groups->size) {
+        size_t parts = 0;
+        bounds[0] = next;
+
+        while (parts < (size_t)threads && next < groups->size) {
+            size_t numbers = 0;
+            while (next < groups->size && numbers < PART_NUMBERS) {
+                numbers += groups->items[next++].size;
+            }
+            bounds[++parts] = next;
+        }
+
+        parallelFor(parts, threads, writeParts, &batch);
+
+        for (size_t i = 0; i < parts; ++i) {
+            WriterAppend(self, &writers[i]);
+        }
+    }
+
+    for (int i = 0; i < threads; ++i) {
+        WriterFree(&writers[i]);
+    }
+    free(writers);
+    free(bounds);
+}
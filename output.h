@@ -0,0 +1,43 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides writer of results. Numbers are formatted by hand
+ *   into large buffer, which is written to file descriptor by few write()
+ *   calls. Writer without file descriptor only collects output in memory,
+ *   such writers are used to format parts of result by separate threads.
+ */
+
+#ifndef SIMILAR_LINES_OUTPUT_H
+#define SIMILAR_LINES_OUTPUT_H
+
+#include "vector.h"
+
+#include <stdlib.h>
+
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t allocated;
+    int fd;             // -1 if output stays in buffer
+} Writer;
+
+Writer WriterNew(int fd);
+
+// flushes writer and frees its buffer
+void WriterFree(Writer *self);
+
+// writes whole buffer to file descriptor
+void WriterFlush(Writer *self);
+
+void WriterChar(Writer *self, char c);
+void WriterBytes(Writer *self, const char *data, size_t length);
+void WriterNumber(Writer *self, unsigned long long x);
+
+// appends output collected by other writer
+void WriterAppend(Writer *self, const Writer *other);
+
+// writes groups, each group in separate line with numbers separated by
+// spaces, groups are formatted by given number of threads
+void writeGroups(Writer *self, const ULLVectorVector *groups, int threads);
+
+#endif //SIMILAR_LINES_OUTPUT_H
@@ -0,0 +1,92 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements running tasks on many threads. The calling thread
+ *   runs the first range itself. Failed allocation in any range is caught,
+ *   so all threads finish, and it is passed to the calling thread after
+ *   they are joined. Each range uses dictionary of words of the calling
+ *   thread.
+ */
+
+#include "parallel.h"
+
+#include "alloc.h"
+#include "intern.h"
+
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdlib.h>
+
+typedef struct {
+    parallelTask task;
+    void *arg;
+    size_t begin;
+    size_t end;
+    Dictionary *dictionary; // dictionary of the calling thread
+    int started;    // set if range runs on its own thread
+    int failed;     // set if allocation failed
+} Range;
+
+static void *runRange(void *arg) {
+    Range *range = arg;
+    jmp_buf recovery;
+    jmp_buf *previous = allocationRecovery;
+    Dictionary *dictionary = internDictionary();
+
+    internUse(range->dictionary);
+    if (setjmp(recovery) == 0) {
+        allocationRecovery = &recovery;
+        range->task(range->begin, range->end, range->arg);
+    }
+    else {
+        range->failed = 1;
+    }
+    allocationRecovery = previous;
+    internUse(dictionary);
+
+    return NULL;
+}
+
+void parallelFor(size_t n, int threads, parallelTask task, void *arg) {
+    if (threads <= 1 || n <= 1) {
+        task(0, n, arg);
+        return;
+    }
+
+    size_t count = (size_t)threads < n ? (size_t)threads : n;
+    Range *ranges = malloc(count * sizeof (Range));
+    pthread_t *ids = malloc(count * sizeof (pthread_t));
+    if (ranges == NULL || ids == NULL) {
+        allocationFailed();
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        Range range = {task, arg, n * i / count, n * (i + 1) / count,
+                       internDictionary(), 0, 0};
+        ranges[i] = range;
+    }
+
+    for (size_t i = 1; i < count; ++i) {
+        ranges[i].started = pthread_create(&ids[i], NULL, runRange,
+                                           &ranges[i]) == 0;
+    }
+
+    // ranges which didn't get thread are run by calling thread
+    int failed = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!ranges[i].started)
+            runRange(&ranges[i]);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (ranges[i].started)
+            pthread_join(ids[i], NULL);
+        failed |= ranges[i].failed;
+    }
+
+    free(ranges);
+    free(ids);
+
+    if (failed)
+        allocationFailed();
+}
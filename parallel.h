@@ -0,0 +1,21 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides function which runs a task over range of indexes
+ *   on many threads.
+ */
+
+#ifndef SIMILAR_LINES_PARALLEL_H
+#define SIMILAR_LINES_PARALLEL_H
+
+#include <stdlib.h>
+
+// task is called for consecutive ranges of indexes [begin, end)
+typedef void (*parallelTask)(size_t begin, size_t end, void *arg);
+
+// splits [0, n) into at most given number of ranges of similar size and
+// calls task for each of them on separate thread
+// returns after all tasks finished
+void parallelFor(size_t n, int threads, parallelTask task, void *arg);
+
+#endif //SIMILAR_LINES_PARALLEL_H
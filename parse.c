@@ -1,211 +1,567 @@
-/**
- * Author:  Mateusz Malinowski
- * Date:    March 2021
- *
- * Summary of File:
- *
- *   This file implements conversion string to line object as it is described in
- *   header file and auxiliary functions.
- */
-
-#include "parse.h"
-
-#include "line.h"
-
-#include <ctype.h>
-#include <errno.h>
-
-// finds first whitespace in given string and sets it to '\0'
-static char *findEndOfWord(char *p) {
-    while (!isspace(*p))
-        p++;
-    *p = '\0';
-    return p;
-}
-
-// tries convert word to unsigned long long and push it into line
-// on ERANGE push it into line as a string
-// sets next to the first char of input after converted part
-// returns 1 if converted, 0 otherwise
-static int parseULL(char *input, Line *line, char **next, int base) {
-    errno = 0;
-
-    char *end = NULL;
-    unsigned long long ullValue = strtoull(input, &end, base);
-
-    if (errno == ERANGE) {
-        // ERANGE means that we cannot read it as unsigned long long, so
-        // we should read it as string.
-        end = findEndOfWord(end);
-        SVectorPush(&line->sv, input);
-    }
-    else if (isspace(*end)) { // whole word was correctly converted
-        ULLVectorPush(&line->ullv, ullValue);
-    }
-    else { // there are some chars which are not valid digit
-        return 0;
-    }
-
-    *next = end + 1;
-
-    return 1;
-}
-
-// tries convert word to long long and push it into line
-// on ERANGE push it into line as a string
-// sets next to the first char of input after converted part
-// returns 1 if converted, 0 otherwise
-static int parseLL(char *input, Line *line, char **next) {
-    errno = 0;
-
-    char *end = NULL;
-    long long llValue = strtoll(input, &end, 10);
-
-    if (errno == ERANGE) {
-        // ERANGE means that we cannot read it as long long, so
-        // we should read it as string.
-        end = findEndOfWord(end);
-        SVectorPush(&line->sv, input);
-    }
-    else if (isspace(*end)) { // whole word was correctly converted
-        if (llValue == 0)
-            ULLVectorPush(&line->ullv, 0);
-        else
-            LLVectorPush(&line->llv, llValue);
-    }
-    else { // there are some chars which are not valid digit
-        return 0;
-    }
-
-    *next = end + 1;
-
-    return 1;
-}
-
-// checks if word could be an octal number and tries convert it
-// returns 1 if converted, 0 otherwise
-static int parseOct(char *input, Line *line, char **next) {
-    if (input[0] != '0')
-        return 0;
-
-    return parseULL(input, line, next, 8);
-}
-
-// checks if word could be an hexadecimal number and tries convert it
-// returns 1 if converted, 0 otherwise
-static int parseHex(char *input, Line *line, char **next) {
-    if (!(input[0] == '0' && input[1] == 'x'))
-        return 0;
-
-    // as it was said on the forum, "0x" is number, but for strtoull it's not
-    if (isspace(input[2])) {
-        ULLVectorPush(&line->ullv, 0);
-        *next = input + 3;
-        return 1;
-    }
-
-    return parseULL(input, line, next, 16);
-}
-
-// tries convert word as decimal number
-// returns 1 if converted, 0 otherwise
-static int parseDec(char *input, Line *line, char **next) {
-    if (input[0] == '-')
-        return parseLL(input, line, next);
-    else
-        return parseULL(input, line, next, 10);
-}
-
-// checks edge cases form the forum
-// returns 1 if given word is not valid double
-static int edgeCases(const char *s) {
-    return (s[0] == 'n' && s[1] == 'a' && s[2] == 'n') ||
-        ((s[0] == '+' || s[0] == '-') && s[1] == 'n' && s[2] == 'a' &&
-            s[3] == 'n') ||
-        ((s[0] == '+' || s[0] == '-') && s[1] == '.' && s[2] == 'e') ||
-        (s[0] == '0' && s[1] == 'x') ||
-        ((s[0] == '+' || s[0] == '-') && s[1] == '0' && s[2] == 'x');
-}
-
-// tries convert word to double and push it into line
-// if number can be represented as unsigned long long or long long,
-// it is converted and pushed into line as corresponding type
-// on ERANGE push it into line as a string
-// sets next to the first char of input after converted part
-// returns 1 if converted, 0 otherwise
-static int parseDouble(char *input, Line *line, char **next) {
-    if (edgeCases(input))
-        return 0;
-
-    errno = 0;
-
-    char *end = NULL;
-    double dValue = strtod(input, &end);
-
-    if (errno == ERANGE) {
-        // ERANGE means that we cannot read it as double, so
-        // we should read it as string.
-        end = findEndOfWord(end);
-        SVectorPush(&line->sv, input);
-    }
-    else if (isspace(*end)) { // whole word was correctly converted
-        if (dValue >= 0) {
-            unsigned long long ullValue = (unsigned long long)dValue;
-            if ((double)ullValue == dValue)
-                ULLVectorPush(&line->ullv, ullValue);
-            else
-                DVectorPush(&line->dv, dValue);
-        }
-        else {
-            long long llValue = (long long)dValue;
-            if ((double)llValue == dValue)
-                LLVectorPush(&line->llv, llValue);
-            else
-                DVectorPush(&line->dv, dValue);
-        }
-    }
-    else { // there are some chars which are not valid digit
-        return 0;
-    }
-
-    *next = end + 1;
-
-    return 1;
-}
-
-static int parseString(char *input, Line *line, char **next) {
-    *next = findEndOfWord(input) + 1;
-    SVectorPush(&line->sv, input);
-
-    return 1;
-};
-
-static void parseWord(char *input, Line *line, char **next) {
-    // skip whitespaces
-    while (isspace(*input)) {
-        input++;
-    }
-
-    if (*input == '\0') {
-        *next = input;
-        return;
-    }
-
-    // Hex always begins with "0x", oct with "0", so parseHex should be called
-    // before parseOct.
-    // All correct octal number could be parsed as decimal, but not the other
-    // way around, so parseOct should be called before parseDec.
-    // All correct decimal numbers could be parsed as double, but not the
-    // other way around, so parseDec should be called before parseDouble.
-    (void)(parseHex(input, line, next) ||
-           parseOct(input, line, next) ||
-           parseDec(input, line, next) ||
-           parseDouble(input, line, next) ||
-           parseString(input, line, next));
-}
-
-void parseLine(char *input, Line *line) {
-    while (*input != '\0') {
-        parseWord(input, line, &input);
-    }
-}
\ No newline at end of file
+/**
+ * Author:  Mateusz Malinowski
+ * Date:    March 2021
+ *
+ * Summary of File:
+ *
+ *   This file implements conversion string to line object as it is described in
+ *   header file and auxiliary functions.
+ *   Words are classified and converted by hand, without strtoull, strtoll and
+ *   strtod, but the results are the same as if these functions were called
+ *   one after another. Only doubles which can't be converted exactly by
+ *   Clinger's fast path are converted by strtod.
+ *   Lines are not scanned byte by byte, scanner walks structural index of
+ *   the block made by classifyBlock().
+ *   Push scanner converts complete lines of chunk by line scanner. Only
+ *   lines split between chunks are scanned byte by byte, their tokens are
+ *   collected one at a time and converted as soon as they end.
+ */
+
+#include "parse.h"
+
+#include "alloc.h"
+#include "classify.h"
+#include "intern.h"
+#include "line.h"
+#include "stats.h"
+#include "vector.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// words shorter than this are copied into buffer on the stack
+#define WORD_BUFFER_SIZE 128
+
+// block is classified in parts of about this size, so structural index of
+// part stays in cache
+static const size_t PART_SIZE = 1 << 16;
+
+static const size_t INITIAL_TOKEN_SIZE = 64;
+
+static const unsigned long long MAX_LL_MAGNITUDE = 1ULL << 63;
+
+// doubles below 2^53 are integers which have exact representation
+static const unsigned long long MAX_EXACT_MANTISSA = 1ULL << 53;
+
+// powers of ten which have exact representation as double
+static const double EXACT_POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+    1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+static const int MAX_EXACT_POWER = 22;
+
+// value of digit increased by one, 0 for chars which are not digits
+static const unsigned char DIGIT_VALUE[256] = {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+    ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16
+};
+
+// returns value of digit in given base or -1 if c isn't such digit
+static inline int digit(char c, int base) {
+    int value = DIGIT_VALUE[(unsigned char)c] - 1;
+    return value < base ? value : -1;
+}
+
+// pushes word into line as id of interned string, retained word isn't
+// copied
+static void pushString(const char *word, size_t length, int retained,
+                       Line *line) {
+    unsigned int id = retained ? internRetainedWord(word, length)
+                               : internWord(word, length);
+    SVectorPush(&line->sv, id);
+}
+
+// reads digits of given base as strtoull does, starting from word[i]
+// sets overflow if value doesn't fit into unsigned long long
+// returns index of the first char which isn't digit
+static size_t readDigits(const char *word, size_t i, size_t length, int base,
+                         unsigned long long *value, int *overflow) {
+    unsigned long long v = 0;
+    int o = 0;
+
+    for (; i < length; ++i) {
+        int d = digit(word[i], base);
+        if (d < 0)
+            break;
+        if (v > (ULLONG_MAX - (unsigned)d) / (unsigned)base)
+            o = 1;
+        else
+            v = v * (unsigned)base + (unsigned)d;
+    }
+
+    *value = v;
+    *overflow = o;
+
+    return i;
+}
+
+// checks edge cases form the forum
+// returns 1 if given word is not valid double
+static int edgeCases(const char *s, size_t n) {
+    char c[4] = {0, 0, 0, 0};
+    memcpy(c, s, n < 4 ? n : 4);
+
+    return (c[0] == 'n' && c[1] == 'a' && c[2] == 'n') ||
+        ((c[0] == '+' || c[0] == '-') && c[1] == 'n' && c[2] == 'a' &&
+            c[3] == 'n') ||
+        ((c[0] == '+' || c[0] == '-') && c[1] == '.' && c[2] == 'e') ||
+        (c[0] == '0' && c[1] == 'x') ||
+        ((c[0] == '+' || c[0] == '-') && c[1] == '0' && c[2] == 'x');
+}
+
+// checks if word from i begins with given text
+static int hasText(const char *word, size_t i, size_t length,
+                   const char *text) {
+    size_t n = strlen(text);
+    return length - i >= n && memcmp(word + i, text, n) == 0;
+}
+
+// checks if whole word is double in format accepted by strtod (without hex
+// and nan, which are edge cases), if so converts it
+// mantissa up to 19 digits and small exponent are converted exactly by one
+// multiplication or division (Clinger's fast path), other numbers by strtod
+// returns 1 if converted, 0 if it isn't double, -1 on ERANGE
+static int readDouble(const char *word, size_t length, double *value) {
+    size_t i = 0;
+    int negative = 0;
+
+    if (i < length && (word[i] == '+' || word[i] == '-'))
+        negative = word[i++] == '-';
+
+    if (hasText(word, i, length, "inf")) {
+        if (length - i != 3 && !(length - i == 8 &&
+                                  hasText(word, i, length, "infinity")))
+            return 0;
+        *value = negative ? -HUGE_VAL : HUGE_VAL;
+        return 1;
+    }
+
+    unsigned long long mantissa = 0;
+    int digits = 0;         // significant digits in mantissa
+    int anyDigit = 0;
+    int exact = 1;          // 0 if some digits didn't fit into mantissa
+    long long exponent = 0;
+    int d;
+
+    for (; i < length && (d = digit(word[i], 10)) >= 0; ++i) {
+        anyDigit = 1;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (unsigned)d;
+            digits += mantissa > 0;
+        } else {
+            exponent++;
+            exact = 0;
+        }
+    }
+
+    if (i < length && word[i] == '.') {
+        for (++i; i < length && (d = digit(word[i], 10)) >= 0; ++i) {
+            anyDigit = 1;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (unsigned)d;
+                digits += mantissa > 0;
+                exponent--;
+            } else {
+                exact = 0;
+            }
+        }
+    }
+
+    if (!anyDigit)
+        return 0;
+
+    // exponent is read only if it's correct, otherwise strtod stops at 'e'
+    if (i < length && word[i] == 'e') {
+        size_t j = i + 1;
+        int negativeExponent = 0;
+        if (j < length && (word[j] == '+' || word[j] == '-'))
+            negativeExponent = word[j++] == '-';
+        if (j < length && digit(word[j], 10) >= 0) {
+            long long e = 0;
+            for (; j < length && (d = digit(word[j], 10)) >= 0; ++j) {
+                if (e < 100000)
+                    e = e * 10 + d;
+            }
+            exponent += negativeExponent ? -e : e;
+            i = j;
+        }
+    }
+
+    if (i != length)
+        return 0;
+
+    if (mantissa == 0) {
+        *value = negative ? -0.0 : 0.0;
+        return 1;
+    }
+
+    if (exact && mantissa <= MAX_EXACT_MANTISSA &&
+        exponent >= -MAX_EXACT_POWER && exponent <= MAX_EXACT_POWER) {
+        double v = (double)mantissa;
+        if (exponent < 0)
+            v /= EXACT_POWERS_OF_TEN[-exponent];
+        else
+            v *= EXACT_POWERS_OF_TEN[exponent];
+        *value = negative ? -v : v;
+        return 1;
+    }
+
+    // strtod needs word ended by '\0'
+    char buffer[WORD_BUFFER_SIZE];
+    char *copy = buffer;
+    if (length >= WORD_BUFFER_SIZE) {
+        copy = malloc(length + 1);
+        if (copy == NULL) {
+            allocationFailed();
+        }
+    }
+    memcpy(copy, word, length);
+    copy[length] = '\0';
+
+    errno = 0;
+    *value = strtod(copy, NULL);
+    int res = errno == ERANGE ? -1 : 1;
+
+    if (copy != buffer)
+        free(copy);
+
+    return res;
+}
+
+// pushes double as unsigned long long or long long if it is integer which can
+// be represented by these types, as double otherwise
+static void pushDouble(double dValue, Line *line) {
+    if (dValue >= 0) {
+        if (dValue < (double)ULLONG_MAX) {
+            unsigned long long ullValue = (unsigned long long)dValue;
+            if ((double)ullValue == dValue) {
+                ULLVectorPush(&line->ullv, ullValue);
+                return;
+            }
+        }
+    }
+    else {
+        if (dValue >= (double)LLONG_MIN) {
+            long long llValue = (long long)dValue;
+            if ((double)llValue == dValue) {
+                LLVectorPush(&line->llv, llValue);
+                return;
+            }
+        }
+    }
+
+    DVectorPush(&line->dv, dValue);
+}
+
+// converts lowercase word of given length, it works in one pass through
+// word in most cases and gives the same results as calling strtoull with
+// base 16, 8 and 10, strtoll and strtod in this order
+// returns 0 if word isn't number, it isn't pushed into line then
+static int parseWord(const char *word, size_t length, Line *line) {
+    unsigned long long value;
+    int overflow;
+    size_t end;
+
+    // Hex always begins with "0x". If it isn't whole hexadecimal number,
+    // it can't be any other number, because "0x" is edge case of doubles.
+    if (length >= 2 && word[0] == '0' && word[1] == 'x') {
+        // as it was said on the forum, "0x" is number, but for strtoull
+        // it's not
+        if (length == 2) {
+            ULLVectorPush(&line->ullv, 0);
+            return 1;
+        }
+
+        end = readDigits(word, 2, length, 16, &value, &overflow);
+        if (end == length && !overflow) {
+            ULLVectorPush(&line->ullv, value);
+            return 1;
+        }
+        return 0;
+    }
+
+    // Oct always begins with "0". On ERANGE word is a string.
+    if (word[0] == '0') {
+        end = readDigits(word, 0, length, 8, &value, &overflow);
+        if (overflow)
+            return 0;
+        if (end == length) {
+            ULLVectorPush(&line->ullv, value);
+            return 1;
+        }
+    }
+
+    // Decimal number is read as unsigned, it may have sign '+', negative
+    // one as signed. On ERANGE word is a string.
+    if (word[0] == '-') {
+        end = readDigits(word, 1, length, 10, &value, &overflow);
+        if (end > 1) {
+            if (overflow || value > MAX_LL_MAGNITUDE)
+                return 0;
+            if (end == length) {
+                if (value == 0)
+                    ULLVectorPush(&line->ullv, 0);
+                else
+                    LLVectorPush(&line->llv, (long long)(0 - value));
+                return 1;
+            }
+        }
+    }
+    else {
+        size_t begin = word[0] == '+' ? 1 : 0;
+        end = readDigits(word, begin, length, 10, &value, &overflow);
+        if (end > begin) {
+            if (overflow)
+                return 0;
+            if (end == length) {
+                ULLVectorPush(&line->ullv, value);
+                return 1;
+            }
+        }
+    }
+
+    double dValue;
+    int res = edgeCases(word, length) ? 0
+                                      : readDouble(word, length, &dValue);
+    if (res <= 0) // not a number or ERANGE
+        return 0;
+
+    pushDouble(dValue, line);
+    return 1;
+}
+
+// counts line which ended and returns its status, line is cleared if it
+// is incorrect
+static readStatus endLine(LineCounts *counts, int comment, int illegal,
+                          int tokens, Line *line) {
+    if (comment) {
+        counts->comments++;
+        return READ_COMMENT;
+    }
+    if (illegal) {
+        counts->errors++;
+        LineClear(line);
+        return READ_ERROR;
+    }
+    if (tokens == 0) {
+        counts->empty++;
+        return READ_EMPTY_LINE;
+    }
+
+    counts->correct++;
+    counts->ullTokens += line->ullv.size;
+    counts->llTokens += line->llv.size;
+    counts->dTokens += line->dv.size;
+    counts->sTokens += line->sv.size;
+    return READ_OK;
+}
+
+LineScanner LineScannerNew(void) {
+    LineScanner obj = {NULL, 0, 0, 0, StructuralIndexNew(), 0,
+                       {0, 0, 0, 0, 0, 0, 0, 0}, 0};
+    return obj;
+}
+
+void LineScannerFree(LineScanner *self) {
+    StructuralIndexFree(&self->index);
+}
+
+void LineScannerReset(LineScanner *self, char *block, size_t length) {
+    self->block = block;
+    self->length = length;
+    self->part = 0;
+    self->position = 0;
+    self->index.size = 0;
+    self->next = 0;
+}
+
+// classifies next part of block which ends at line boundary
+static void classifyPart(LineScanner *self) {
+    size_t end = self->length;
+
+    if (self->length - self->position > PART_SIZE) {
+        const char *newLine = memchr(self->block + self->position + PART_SIZE,
+                                     '\n',
+                                     self->length - self->position -
+                                     PART_SIZE);
+        if (newLine != NULL)
+            end = (size_t)(newLine - self->block) + 1;
+    }
+
+    self->part = self->position;
+    classifyBlock(self->block + self->part, end - self->part, &self->index);
+    self->next = 0;
+}
+
+readStatus LineScannerNext(LineScanner *self, Line *line) {
+    if (self->position >= self->length)
+        return READ_END;
+
+    if (self->next == self->index.size)
+        classifyPart(self);
+
+    const char *part = self->block + self->part;
+    int comment = self->block[self->position] == '#';
+    int illegal = 0;
+    int tokens = 0;
+    size_t begin = 0;
+
+    for (;;) {
+        size_t item = self->index.items[self->next++];
+        size_t offset = StructuralOffset(item);
+
+        switch (StructuralKind(item)) {
+            case TOKEN_BEGIN:
+                begin = offset;
+                tokens++;
+                break;
+            case TOKEN_END:
+                if (!comment && !illegal &&
+                    !parseWord(part + begin, offset - begin, line))
+                    pushString(part + begin, offset - begin, self->retained,
+                               line);
+                break;
+            case ILLEGAL_CHAR:
+                illegal = 1;
+                break;
+            case LINE_END:
+                self->position = self->part + offset + 1;
+                return endLine(&self->counts, comment, illegal, tokens,
+                               line);
+        }
+    }
+}
+
+PushScanner PushScannerNew(void) {
+    PushScanner obj = {LineScannerNew(), LineNew(0), NULL, 0, 0, 0, 0, 0, 0,
+                       0};
+    return obj;
+}
+
+void PushScannerFree(PushScanner *self) {
+    LineScannerFree(&self->lines);
+    LineFree(self->line);
+    free(self->line);
+    free(self->token);
+}
+
+// appends byte to unfinished token
+static void pushTokenByte(PushScanner *self, char c) {
+    if (self->tokenLength == self->tokenAllocated) {
+        size_t allocated = self->tokenAllocated == 0
+                           ? INITIAL_TOKEN_SIZE
+                           : self->tokenAllocated * 2;
+        char *token = realloc(self->token, allocated);
+        if (token == NULL) {
+            allocationFailed();
+        }
+        self->token = token;
+        self->tokenAllocated = allocated;
+    }
+
+    self->token[self->tokenLength++] = c;
+}
+
+// converts unfinished token if there is one
+static void endToken(PushScanner *self) {
+    if (!self->inToken)
+        return;
+
+    if (!self->comment && !self->illegal &&
+        !parseWord(self->token, self->tokenLength, self->line))
+        pushString(self->token, self->tokenLength, 0, self->line);
+
+    self->inToken = 0;
+    self->tokenLength = 0;
+}
+
+// ends unfinished line and passes it to handler
+static void endPushedLine(PushScanner *self, pushedLineHandler handler,
+                          void *context) {
+    endToken(self);
+    readStatus status = endLine(&self->lines.counts, self->comment,
+                                self->illegal, self->tokens, self->line);
+    handler(context, status, self->line);
+    LineClear(self->line);
+
+    self->inLine = 0;
+    self->comment = 0;
+    self->illegal = 0;
+    self->tokens = 0;
+}
+
+// continues unfinished line with bytes of data, line is ended if data
+// contains '\n', returns number of used bytes
+// tokens of comments and incorrect lines aren't kept, so only tokens of
+// correct line take memory
+static size_t continueLine(PushScanner *self, const char *data,
+                           size_t length, pushedLineHandler handler,
+                           void *context) {
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char c = (unsigned char)data[i];
+
+        if (!self->inLine) {
+            self->inLine = 1;
+            self->comment = c == '#';
+        }
+
+        if (c == '\n') {
+            endPushedLine(self, handler, context);
+            return i + 1;
+        }
+        if (c == ' ' || (c >= '\t' && c <= '\r')) {
+            endToken(self);
+            continue;
+        }
+
+        if (c < 33 || c > 126)
+            self->illegal = 1;
+        if (!self->inToken) {
+            self->inToken = 1;
+            self->tokens++;
+        }
+        if (self->comment || self->illegal)
+            continue;
+
+        if (c >= 'A' && c <= 'Z')
+            c = (unsigned char)(c - 'A' + 'a');
+        pushTokenByte(self, (char)c);
+    }
+
+    return length;
+}
+
+void PushScannerPush(PushScanner *self, char *chunk, size_t length,
+                     pushedLineHandler handler, void *context) {
+    size_t begin = 0;
+    if (self->inLine)
+        begin = continueLine(self, chunk, length, handler, context);
+
+    // complete lines are converted in place as by line scanner
+    size_t end = length;
+    while (end > begin && chunk[end - 1] != '\n') {
+        --end;
+    }
+
+    if (end > begin) {
+        readStatus status;
+        LineScannerReset(&self->lines, chunk + begin, end - begin);
+        while ((status = LineScannerNext(&self->lines, self->line)) !=
+               READ_END) {
+            handler(context, status, self->line);
+            LineClear(self->line);
+        }
+    }
+
+    continueLine(self, chunk + end, length - end, handler, context);
+}
+
+void PushScannerFinish(PushScanner *self, pushedLineHandler handler,
+                       void *context) {
+    if (self->inLine)
+        endPushedLine(self, handler, context);
+}
@@ -1,24 +1,89 @@
-/**
- * Author:  Mateusz Malinowski
- * Date:    March 2021
- *
- * Summary of File:
- *
- *   This header provides function which convert string to line object.
- *   All numbers which can be represented as unsigned long long are converted
- *   to unsigned long long. If number can't be converted to unsigned long long
- *   algorithm tries convert it to long long if possible. If not algorithm tries
- *   convert it to double. If it fails that means it's not-number and should be
- *   stored as string.
- */
-
-#ifndef SIMILAR_LINES_PARSE_H
-#define SIMILAR_LINES_PARSE_H
-
-#include "line.h"
-
-// converts all numbers from input into corresponding types and pushes them
-// into line, also pushes non-words
-void parseLine(char *input, Line *line);
-
-#endif //SIMILAR_LINES_PARSE_H
+/**
+ * Author:  Mateusz Malinowski
+ * Date:    March 2021
+ *
+ * Summary of File:
+ *
+ *   This header provides scanners which convert lines of input to line
+ *   objects, line scanner for blocks of complete lines and push scanner
+ *   for input split anywhere.
+ *   All numbers which can be represented as unsigned long long are converted
+ *   to unsigned long long. If number can't be converted to unsigned long long
+ *   algorithm tries convert it to long long if possible. If not algorithm tries
+ *   convert it to double. If it fails that means it's not-number and should be
+ *   stored as string.
+ */
+
+#ifndef SIMILAR_LINES_PARSE_H
+#define SIMILAR_LINES_PARSE_H
+
+#include "classify.h"
+#include "line.h"
+#include "stats.h"
+
+typedef enum {
+    READ_OK,
+    READ_ERROR,
+    READ_COMMENT,
+    READ_EMPTY_LINE,
+    READ_END
+} readStatus;
+
+// converts lines of block one by one
+typedef struct {
+    char *block;
+    size_t length;
+    size_t part;            // offset of classified part of block
+    size_t position;        // offset of the next line
+    StructuralIndex index;  // index of classified part
+    size_t next;            // the next item of index
+    LineCounts counts;      // lines and tokens scanned so far
+    int retained;           // set if blocks stay valid until internFree,
+                            // their words aren't copied then
+} LineScanner;
+
+LineScanner LineScannerNew(void);
+void LineScannerFree(LineScanner *self);
+
+// sets block of complete lines which is scanned, only the last line may not
+// end with '\n', block is lowercased in place while it is scanned
+void LineScannerReset(LineScanner *self, char *block, size_t length);
+
+// checks if the next line of block is comment, empty or contains illegal
+// characters, converts correct line into given line, which should be empty
+// returns READ_END if there are no more lines
+readStatus LineScannerNext(LineScanner *self, Line *line);
+
+// called for each line scanned by push scanner, line is converted only if
+// status is READ_OK and it is cleared after handler returns
+typedef void (*pushedLineHandler)(void *context, readStatus status,
+                                  Line *line);
+
+// converts input pushed in chunks of any size, lines may be split between
+// chunks, only the unfinished token is kept between chunks
+typedef struct {
+    LineScanner lines;      // converts complete lines of chunks
+    Line *line;             // the current line
+    char *token;            // lowercased bytes of unfinished token
+    size_t tokenLength;
+    size_t tokenAllocated;
+    int inLine;             // set if the current line is unfinished
+    int inToken;
+    int comment;
+    int illegal;
+    int tokens;             // number of tokens of the current line
+} PushScanner;
+
+PushScanner PushScannerNew(void);
+void PushScannerFree(PushScanner *self);
+
+// converts chunk and calls handler for each line ended in it, chunk is
+// lowercased in place
+void PushScannerPush(PushScanner *self, char *chunk, size_t length,
+                     pushedLineHandler handler, void *context);
+
+// ends input, the last line doesn't have to end with '\n'
+void PushScannerFinish(PushScanner *self, pushedLineHandler handler,
+                       void *context);
+
+#endif //SIMILAR_LINES_PARSE_H
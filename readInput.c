@@ -1,132 +1,443 @@
-/**
- * Author:  Mateusz Malinowski
- * Date:    March 2021
- *
- * Summary of File:
- *
- *   This file implements reading lines from stdin operations.
- */
-
-#include "readInput.h"
-
-#include "line.h"
-#include "lineVector.h"
-#include "parse.h"
-
-#include <stdio.h>
-#include <ctype.h>
-
-typedef enum {
-    READ_OK,
-    READ_ERROR,
-    READ_END,
-    READ_COMMENT,
-    READ_EMPTY_LINE,
-    UNDEFINED
-} readStatus;
-
-// reads all chars to '\n' or EOF and discard them
-static void skipLine() {
-    char c;
-    while ((c = (char)getchar()) != EOF && c != '\n');
-}
-
-// returns 0 if given string contains only whitespaces, non-zero otherwise
-static int isEmpty(char *str) {
-    while (isspace(*str)) {
-        str++;
-    }
-    return *str == '\0';
-}
-
-// reads line, checks if it is comment or contains illegal characters
-// sets read status
-// returns pointer to buffer in which are read characters
-static char *getline(readStatus *status) {
-    char c = (char)getchar();
-
-    if (feof(stdin)) {
-        *status = READ_END;
-        return NULL;
-    }
-
-    if (c == '#') {
-        skipLine();
-        *status = READ_COMMENT;
-        return NULL;
-    }
-
-    CVector input = CVectorNew();
-
-     do {
-        if (isspace(c) || (c >= 33 && c <= 126)) {
-            CVectorPush(&input, (char)tolower(c));
-        } else {
-            *status = READ_ERROR;
-            CVectorFree(&input);
-            skipLine();
-            return NULL;
-        }
-    } while (c != '\n' && (c = (char)getchar()) != EOF);
-
-    if (c != '\n') {
-        CVectorPush(&input, '\n');
-    }
-
-    CVectorPush(&input, '\0');
-
-    if (isEmpty(input.items)) {
-        *status = READ_EMPTY_LINE;
-        CVectorFree(&input);
-        return NULL;
-    }
-
-    return input.items;
-}
-
-// reads line and convert it
-static int readLine(Line *line) {
-    readStatus status = UNDEFINED;
-    char *input = getline(&status);
-
-    if (status != UNDEFINED)
-        return status;
-
-    parseLine(input, line);
-
-    free(input);
-
-    return READ_OK;
-}
-
-// read input line by line, converts them to proper object and pushes them into
-// line vector.
-void readInput(LineVector *lv) {
-    int nr = 0;
-
-    while (1) {
-        Line *line = LineNew(++nr);
-        int status = readLine(line);
-
-        switch (status) {
-            case READ_OK:
-                LineVectorPush(lv, *line);
-                free(line);
-                break;
-            case READ_ERROR:
-                fprintf(stderr, "ERROR %d\n", line->nr);
-                LineFree(line);
-                free(line);
-                break;
-            case READ_EMPTY_LINE:
-            case READ_COMMENT:
-                LineFree(line);
-                free(line);
-                break;
-            case READ_END:
-                LineFree(line);
-                free(line);
-                return;
-        }
-    }
-}
\ No newline at end of file
+/**
+ * Author:  Mateusz Malinowski
+ * Date:    March 2021
+ *
+ * Summary of File:
+ *
+ *   This file implements reading lines from input operations.
+ *   Input is taken from reader in blocks of complete lines, each line is
+ *   checked and converted in place by line scanner, without copying it into
+ *   own buffer.
+ *   Lines are converted into one reused line, so only correct lines are
+ *   copied into line vector.
+ *   Mapped file may be retained, then it is handed over to dictionary of
+ *   words and words of lines point into it instead of being copied.
+ *   Mapped file can be split into chunks at line boundaries, which are
+ *   converted by separate threads. Each thread numbers lines of its chunk
+ *   from 1, numbers are corrected when chunks are joined in input order.
+ *   Other inputs read by one thread are converted by push scanner as they
+ *   come, so lines don't have to fit into buffer of reader.
+ *   Other inputs read by many threads are pipelined: one thread reads
+ *   blocks into buffers of a ring of jobs, parser threads convert filled
+ *   jobs in any order and the calling thread joins converted jobs in input
+ *   order, like chunks of mapped file. Reader waits when all jobs of ring
+ *   are in use, so memory is bounded however fast input comes.
+ */
+
+#include "readInput.h"
+
+#include "alloc.h"
+#include "intern.h"
+#include "line.h"
+#include "lineVector.h"
+#include "output.h"
+#include "parse.h"
+#include "reader.h"
+#include "stats.h"
+#include "vector.h"
+
+#include <pthread.h>
+#include <string.h>
+
+// size of input which reader puts into one job
+const size_t PIPELINE_BLOCK_SIZE = 1 << 20;
+
+// ring of jobs has this many jobs for each parser thread
+const size_t PIPELINE_JOBS_PER_THREAD = 2;
+
+// part of input converted by one thread
+typedef struct {
+    char *block;
+    size_t length;
+    size_t allocated;   // size of own buffer of block, 0 if it isn't owned
+    LineVector lines;
+    ULLVector errors;   // numbers of incorrect lines
+    int lineCount;
+    int parsed;         // set when job of pipeline was converted
+    int retained;       // set if block stays valid until internFree
+} Chunk;
+
+// job with sequence number s is jobs[s % jobCount], all counters grow
+// and are changed under lock, change is announced by changed
+typedef struct {
+    Reader *reader;
+    Chunk *jobs;
+    size_t jobCount;
+    unsigned long long filled;      // number of jobs filled by reader
+    unsigned long long taken;       // number of jobs taken by parsers
+    unsigned long long consumed;    // number of jobs joined into lines
+    int end;                        // set after the last job was filled
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} Pipeline;
+
+// splits block into lines, converts them and pushes them into line vector,
+// numbers of incorrect lines are pushed into errors
+// nr is number of the last read line, line is buffer for converted line
+static void readBlock(char *block, size_t length, int *nr, Line *line,
+                      LineScanner *scanner, LineVector *lv,
+                      ULLVector *errors) {
+    readStatus status;
+
+    LineScannerReset(scanner, block, length);
+
+    while ((status = LineScannerNext(scanner, line)) != READ_END) {
+        ++*nr;
+
+        switch (status) {
+            case READ_OK:
+                line->nr = *nr;
+                LineVectorPush(lv, line);
+                LineClear(line);
+                break;
+            case READ_ERROR:
+                ULLVectorPush(errors, (unsigned long long)*nr);
+                break;
+            case READ_EMPTY_LINE:
+            case READ_COMMENT:
+            case READ_END:
+                break;
+        }
+    }
+}
+
+// writes numbers of incorrect lines increased by offset and clears errors
+static void printErrors(Writer *out, ULLVector *errors, int offset) {
+    for (size_t i = 0; i < errors->size; ++i) {
+        WriterBytes(out, "ERROR ", 6);
+        WriterNumber(out, ULLVectorItems(errors)[i] + offset);
+        WriterChar(out, '\n');
+    }
+    errors->size = 0;
+}
+
+static void *readChunk(void *arg) {
+    Chunk *chunk = arg;
+    Line *line = LineNew(0);
+    LineScanner scanner = LineScannerNew();
+    scanner.retained = chunk->retained;
+
+    readBlock(chunk->block, chunk->length, &chunk->lineCount, line,
+              &scanner, &chunk->lines, &chunk->errors);
+
+    statsAddLines(&scanner.counts);
+    LineScannerFree(&scanner);
+    LineFree(line);
+    free(line);
+
+    return NULL;
+}
+
+// splits block into at most n chunks which end at line boundaries
+// returns number of chunks
+static int splitBlock(char *block, size_t length, int retained,
+                      Chunk *chunks, int n) {
+    int count = 0;
+    size_t begin = 0;
+
+    for (int i = 1; i <= n && begin < length; ++i) {
+        size_t end = i == n ? length : length / n * i;
+        if (end < begin)
+            end = begin;
+
+        const char *newLine = memchr(block + end, '\n', length - end);
+        end = newLine ? (size_t)(newLine - block) + 1 : length;
+
+        Chunk chunk = {block + begin, end - begin, 0, LineVectorNew(),
+                       ULLVectorNew(), 0, 0, retained};
+        chunks[count++] = chunk;
+        begin = end;
+    }
+
+    return count;
+}
+
+// converts block by given number of threads
+static void readBlockInParallel(char *block, size_t length, int retained,
+                                int threads, LineVector *lv, Writer *out) {
+    Chunk *chunks = malloc(threads * sizeof (Chunk));
+    pthread_t *ids = malloc(threads * sizeof (pthread_t));
+    if (chunks == NULL || ids == NULL) {
+        allocationFailed();
+    }
+
+    int n = splitBlock(block, length, retained, chunks, threads);
+
+    for (int i = 0; i < n; ++i) {
+        if (pthread_create(&ids[i], NULL, readChunk, &chunks[i]) != 0) {
+            allocationFailed();
+        }
+    }
+
+    int offset = 0;
+    for (int i = 0; i < n; ++i) {
+        pthread_join(ids[i], NULL);
+
+        for (size_t j = 0; j < chunks[i].lines.size; ++j) {
+            chunks[i].lines.items[j].nr += offset;
+        }
+        printErrors(out, &chunks[i].errors, offset);
+        LineVectorAppend(lv, &chunks[i].lines);
+        ULLVectorFree(&chunks[i].errors);
+
+        offset += chunks[i].lineCount;
+    }
+
+    free(chunks);
+    free(ids);
+}
+
+// copies block at the end of block of job, grows its buffer if needed
+static void appendBlock(Chunk *job, const char *block, size_t length) {
+    if (job->length + length > job->allocated) {
+        size_t allocated = job->allocated == 0 ? PIPELINE_BLOCK_SIZE
+                                               : job->allocated * 2;
+        while (allocated < job->length + length) {
+            allocated *= 2;
+        }
+
+        job->block = realloc(job->block, allocated);
+        if (job->block == NULL) {
+            allocationFailed();
+        }
+        job->allocated = allocated;
+    }
+
+    memcpy(job->block + job->length, block, length);
+    job->length += length;
+}
+
+// fills free jobs of ring with blocks of input
+static void *readJobs(void *arg) {
+    Pipeline *p = arg;
+    char *block = NULL;
+    size_t length = 0;
+    int more = 1;
+
+    while (more) {
+        pthread_mutex_lock(&p->lock);
+        while (p->filled - p->consumed == p->jobCount) {
+            pthread_cond_wait(&p->changed, &p->lock);
+        }
+        Chunk *job = &p->jobs[p->filled % p->jobCount];
+        pthread_mutex_unlock(&p->lock);
+
+        // job isn't used by other threads until it is counted as filled
+        job->length = 0;
+        while (job->length < PIPELINE_BLOCK_SIZE &&
+               (more = ReaderNextBlock(p->reader, &block, &length) > 0)) {
+            appendBlock(job, block, length);
+        }
+
+        pthread_mutex_lock(&p->lock);
+        if (job->length > 0) {
+            job->parsed = 0;
+            p->filled++;
+        }
+        p->end = !more;
+        pthread_cond_broadcast(&p->changed);
+        pthread_mutex_unlock(&p->lock);
+    }
+
+    return NULL;
+}
+
+// converts filled jobs until input ends
+static void *parseJobs(void *arg) {
+    Pipeline *p = arg;
+    Line *line = LineNew(0);
+    LineScanner scanner = LineScannerNew();
+
+    pthread_mutex_lock(&p->lock);
+    while (1) {
+        while (p->taken == p->filled && !p->end) {
+            pthread_cond_wait(&p->changed, &p->lock);
+        }
+        if (p->taken == p->filled)
+            break;
+
+        Chunk *job = &p->jobs[p->taken++ % p->jobCount];
+        pthread_mutex_unlock(&p->lock);
+
+        job->lineCount = 0;
+        readBlock(job->block, job->length, &job->lineCount, line, &scanner,
+                  &job->lines, &job->errors);
+
+        pthread_mutex_lock(&p->lock);
+        job->parsed = 1;
+        pthread_cond_broadcast(&p->changed);
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    statsAddLines(&scanner.counts);
+    LineScannerFree(&scanner);
+    LineFree(line);
+    free(line);
+
+    return NULL;
+}
+
+// reads input by one thread and converts it by given number of threads,
+// converted jobs are joined in input order
+static void readPipelined(Reader *reader, int threads, LineVector *lv,
+                          Writer *out) {
+    Pipeline p;
+    p.reader = reader;
+    p.jobCount = PIPELINE_JOBS_PER_THREAD * (size_t)threads;
+    p.filled = 0;
+    p.taken = 0;
+    p.consumed = 0;
+    p.end = 0;
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.changed, NULL);
+
+    p.jobs = malloc(p.jobCount * sizeof (Chunk));
+    pthread_t *ids = malloc((threads + 1) * sizeof (pthread_t));
+    if (p.jobs == NULL || ids == NULL) {
+        allocationFailed();
+    }
+    for (size_t i = 0; i < p.jobCount; ++i) {
+        Chunk job = {NULL, 0, 0, LineVectorNew(), ULLVectorNew(), 0, 0, 0};
+        p.jobs[i] = job;
+    }
+
+    if (pthread_create(&ids[0], NULL, readJobs, &p) != 0) {
+        allocationFailed();
+    }
+    for (int i = 1; i <= threads; ++i) {
+        if (pthread_create(&ids[i], NULL, parseJobs, &p) != 0) {
+            allocationFailed();
+        }
+    }
+
+    int offset = 0;
+    pthread_mutex_lock(&p.lock);
+    while (1) {
+        Chunk *job = &p.jobs[p.consumed % p.jobCount];
+        while ((p.consumed == p.filled && !p.end) ||
+               (p.consumed < p.filled && !job->parsed)) {
+            pthread_cond_wait(&p.changed, &p.lock);
+        }
+        if (p.consumed == p.filled)
+            break;
+        pthread_mutex_unlock(&p.lock);
+
+        for (size_t j = 0; j < job->lines.size; ++j) {
+            job->lines.items[j].nr += offset;
+        }
+        printErrors(out, &job->errors, offset);
+        LineVectorAppend(lv, &job->lines);
+        offset += job->lineCount;
+
+        pthread_mutex_lock(&p.lock);
+        p.consumed++;
+        pthread_cond_broadcast(&p.changed);
+    }
+    pthread_mutex_unlock(&p.lock);
+
+    for (int i = 0; i <= threads; ++i) {
+        pthread_join(ids[i], NULL);
+    }
+
+    for (size_t i = 0; i < p.jobCount; ++i) {
+        free(p.jobs[i].block);
+        LineVectorFree(&p.jobs[i].lines);
+        ULLVectorFree(&p.jobs[i].errors);
+    }
+    free(p.jobs);
+    free(ids);
+    pthread_mutex_destroy(&p.lock);
+    pthread_cond_destroy(&p.changed);
+}
+
+// lines converted by push scanner
+typedef struct {
+    LineVector *lv;
+    ULLVector errors;
+    int nr;
+} PushedLines;
+
+static void pushLine(void *context, readStatus status, Line *line) {
+    PushedLines *self = context;
+    ++self->nr;
+
+    if (status == READ_OK) {
+        line->nr = self->nr;
+        LineVectorPush(self->lv, line);
+    }
+    else if (status == READ_ERROR) {
+        ULLVectorPush(&self->errors, (unsigned long long)self->nr);
+    }
+}
+
+// converts input chunk by chunk, memory used by long line depends only on
+// its tokens
+static void readPushed(Reader *reader, LineVector *lv, Writer *out) {
+    PushScanner scanner = PushScannerNew();
+    PushedLines lines = {lv, ULLVectorNew(), 0};
+    char *chunk = NULL;
+    size_t length = 0;
+
+    while (ReaderNextChunk(reader, &chunk, &length) > 0) {
+        PushScannerPush(&scanner, chunk, length, pushLine, &lines);
+        printErrors(out, &lines.errors, 0);
+    }
+    PushScannerFinish(&scanner, pushLine, &lines);
+    printErrors(out, &lines.errors, 0);
+
+    ULLVectorFree(&lines.errors);
+    statsAddLines(&scanner.lines.counts);
+    PushScannerFree(&scanner);
+}
+
+// hands mapped file over to dictionary of words if it was retained,
+// otherwise frees reader
+static void releaseReader(Reader *reader, int retained) {
+    if (retained)
+        internRetainMapping(reader->buffer, reader->size);
+    else
+        ReaderFree(reader);
+}
+
+void readInput(int fd, LineVector *lv, int threads, int retain,
+               Writer *out) {
+    Reader reader = ReaderNew(fd);
+    int retained = retain && reader.mapped;
+    char *block = NULL;
+    size_t length = 0;
+
+    // mapped file is one block, so it can be split
+    if (reader.mapped && threads > 1) {
+        if (ReaderNextBlock(&reader, &block, &length))
+            readBlockInParallel(block, length, retained, threads, lv, out);
+        releaseReader(&reader, retained);
+        return;
+    }
+
+    if (!reader.mapped) {
+        if (threads > 1)
+            readPipelined(&reader, threads, lv, out);
+        else
+            readPushed(&reader, lv, out);
+        ReaderFree(&reader);
+        return;
+    }
+
+    Line *line = LineNew(0);
+    LineScanner scanner = LineScannerNew();
+    ULLVector errors = ULLVectorNew();
+    int nr = 0;
+
+    scanner.retained = retained;
+    while (ReaderNextBlock(&reader, &block, &length)) {
+        readBlock(block, length, &nr, line, &scanner, lv, &errors);
+        printErrors(out, &errors, 0);
+    }
+
+    ULLVectorFree(&errors);
+    statsAddLines(&scanner.counts);
+    LineScannerFree(&scanner);
+    LineFree(line);
+    free(line);
+    releaseReader(&reader, retained);
+}
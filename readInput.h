@@ -1,19 +1,27 @@
-/**
- * Author:  Mateusz Malinowski
- * Date:    March 2021
- *
- * Summary of File:
- *
- *   This header provides function which reads all lines of input, converts
- *   and pushes them into LineVector.
- */
-
-#ifndef SIMILAR_LINES_READINPUT_H
-#define SIMILAR_LINES_READINPUT_H
-
-#include "line.h"
-#include "lineVector.h"
-
-void readInput(LineVector *lv);
-
-#endif //SIMILAR_LINES_READINPUT_H
+/**
+ * Author:  Mateusz Malinowski
+ * Date:    March 2021
+ *
+ * Summary of File:
+ *
+ *   This header provides function which reads all lines of input, converts
+ *   and pushes them into LineVector.
+ */
+
+#ifndef SIMILAR_LINES_READINPUT_H
+#define SIMILAR_LINES_READINPUT_H
+
+#include "line.h"
+#include "lineVector.h"
+#include "output.h"
+
+// reads all lines from file descriptor, numbers of incorrect lines are
+// written to out
+// if fd is a regular file, it is converted by given number of threads,
+// otherwise one more thread reads it while they convert read blocks
+// if retain is set, mapped file is kept until internFree and words of
+// lines point into it
+void readInput(int fd, LineVector *lv, int threads, int retain,
+               Writer *out);
+
+#endif //SIMILAR_LINES_READINPUT_H
@@ -0,0 +1,168 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements reader functions described in related header.
+ */
+
+#include "reader.h"
+
+#include "alloc.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const size_t READ_BLOCK_SIZE = 1 << 20;
+
+// tries map whole regular file into memory, input starts at current offset
+// of file as if it was read, which is moved to end of file
+// returns 1 if mapped, 0 otherwise
+static int mapFile(Reader *self) {
+    struct stat st;
+
+    if (fstat(self->fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+        return 0;
+
+    off_t offset = lseek(self->fd, 0, SEEK_CUR);
+    if (offset < 0 || offset >= st.st_size)
+        return 0;
+
+    // pages are private copies, so input can be changed in place
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE, self->fd, 0);
+    if (data == MAP_FAILED)
+        return 0;
+
+    posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+
+    self->buffer = data;
+    self->size = (size_t)st.st_size;
+    self->position = (size_t)offset;
+    self->mapped = 1;
+    lseek(self->fd, 0, SEEK_END);
+
+    return 1;
+}
+
+Reader ReaderNewBuffered(int fd) {
+    Reader obj = {NULL, 0, 0, 0, fd, 0, 0, 0};
+
+    obj.buffer = malloc(READ_BLOCK_SIZE);
+    if (obj.buffer == NULL) {
+        allocationFailed();
+    }
+    obj.allocated = READ_BLOCK_SIZE;
+
+    return obj;
+}
+
+Reader ReaderNew(int fd) {
+    Reader obj = {NULL, 0, 0, 0, fd, 0, 0, 0};
+
+    if (!mapFile(&obj))
+        obj = ReaderNewBuffered(fd);
+
+    return obj;
+}
+
+void ReaderFree(Reader *self) {
+    if (self->mapped)
+        munmap(self->buffer, self->size);
+    else
+        free(self->buffer);
+}
+
+// returns index after last '\n' in buffer[from, to) or 0 if there is none
+static size_t findLastNewLine(const char *buffer, size_t from, size_t to) {
+    while (to > from) {
+        if (buffer[--to] == '\n')
+            return to + 1;
+    }
+    return 0;
+}
+
+// reads next part of input into free space of buffer, grows buffer if needed
+// returns number of read bytes, 0 on end of input, -1 if interrupted
+static ssize_t fillBuffer(Reader *self) {
+    if (self->size == self->allocated) {
+        self->buffer = realloc(self->buffer, self->allocated * 2);
+        if (self->buffer == NULL) {
+            allocationFailed();
+        }
+        self->allocated *= 2;
+    }
+
+    while (1) {
+        ssize_t n = read(self->fd, self->buffer + self->size,
+                         self->allocated - self->size);
+        if (n < 0 && errno == EINTR) {
+            if (self->interruptible)
+                return -1;
+            continue;
+        }
+        if (n <= 0) { // read error is treated like end of input
+            self->end = 1;
+            return 0;
+        }
+        self->size += (size_t)n;
+        return n;
+    }
+}
+
+int ReaderNextBlock(Reader *self, char **block, size_t *length) {
+    if (self->mapped) {
+        if (self->position == self->size)
+            return 0;
+        *block = self->buffer + self->position;
+        *length = self->size - self->position;
+        self->position = self->size;
+        return 1;
+    }
+
+    // move carried part of line to the beginning of buffer
+    self->size -= self->position;
+    memmove(self->buffer, self->buffer + self->position, self->size);
+    self->position = 0;
+
+    size_t blockEnd = 0;
+    while (blockEnd == 0 && !self->end) {
+        size_t scanned = self->size;
+        ssize_t n = fillBuffer(self);
+        if (n < 0)
+            return -1;
+        blockEnd = findLastNewLine(self->buffer, scanned,
+                                   scanned + (size_t)n);
+    }
+
+    if (self->end)
+        blockEnd = self->size; // last line doesn't have to end with '\n'
+
+    if (blockEnd == 0)
+        return 0;
+
+    *block = self->buffer;
+    *length = blockEnd;
+    self->position = blockEnd;
+
+    return 1;
+}
+
+int ReaderNextChunk(Reader *self, char **chunk, size_t *length) {
+    if (self->mapped)
+        return ReaderNextBlock(self, chunk, length);
+
+    self->size = 0;
+    if (self->end)
+        return 0;
+
+    ssize_t n = fillBuffer(self);
+    if (n <= 0)
+        return (int)n;
+
+    *chunk = self->buffer;
+    *length = (size_t)n;
+    return 1;
+}
@@ -0,0 +1,48 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides reader structure which hands out input in blocks of
+ *   complete lines. Regular files are mapped into memory, so the rest of
+ *   file from its current offset is one block and nothing is copied. Other
+ *   inputs (e.g. pipes) are read with read() in large blocks, the part of
+ *   the last incomplete line is carried over to the next block.
+ */
+
+#ifndef SIMILAR_LINES_READER_H
+#define SIMILAR_LINES_READER_H
+
+#include <stdlib.h>
+
+typedef struct {
+    char *buffer;       // mapped file or read buffer
+    size_t size;        // number of valid bytes in buffer
+    size_t allocated;   // size of read buffer, 0 if buffer is mapped
+    size_t position;    // first byte which was not handed out yet
+    int fd;
+    int mapped;
+    int end;            // set when read() returned end of file
+    int interruptible;  // if set, signals interrupt waiting for input
+} Reader;
+
+Reader ReaderNew(int fd);
+
+// returns reader which doesn't map regular files, so memory used by it
+// doesn't depend on size of input
+Reader ReaderNewBuffered(int fd);
+void ReaderFree(Reader *self);
+
+// sets block to the next part of input which consists of complete lines,
+// only the last line of input may not end with '\n'
+// block is valid until next call
+// returns 1 if block was read, 0 on end of input, -1 if reader is
+// interruptible and read() was interrupted by signal
+int ReaderNextBlock(Reader *self, char **block, size_t *length);
+
+// sets chunk to the next part of input as it was read, lines may be split
+// between chunks, so buffer of reader doesn't grow with length of lines
+// chunk is valid until next call, it can't be mixed with ReaderNextBlock
+// returns 1 if chunk was read, 0 on end of input, -1 if reader is
+// interruptible and read() was interrupted by signal
+int ReaderNextChunk(Reader *self, char **chunk, size_t *length);
+
+#endif //SIMILAR_LINES_READER_H
@@ -0,0 +1,212 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements library interface. Pushed bytes are copied into
+ *   buffer of context piece by piece, because push scanner lowercases them
+ *   in place, and each piece is converted at once. Only the unfinished
+ *   token of line split between pieces is kept, so memory doesn't depend
+ *   on sizes of pushed buffers or on lengths of lines.
+ *   Each function sets recovery point of its thread (see alloc.h), so
+ *   failed allocation returns error code from it. Each context has its own
+ *   dictionary of words, which its functions make current for their thread
+ *   and which is cleared when lines are finished.
+ */
+
+#include "similarLines.h"
+
+#include "alloc.h"
+#include "approx.h"
+#include "group.h"
+#include "intern.h"
+#include "line.h"
+#include "lineVector.h"
+#include "parse.h"
+#include "vector.h"
+
+#include <setjmp.h>
+#include <string.h>
+
+const size_t PUSH_BUFFER_SIZE = 1 << 16;
+
+static const double DEFAULT_APPROX_THRESHOLD = 0.8;
+
+struct SimilarLines {
+    SimilarLinesConfig config;
+    SimilarLinesCallbacks callbacks;
+    char *buffer;           // copy of piece of pushed bytes
+    LineVector lines;
+    PushScanner scanner;
+    Dictionary *dictionary; // words of lines pushed since the last finish
+    int nr;                 // number of the last converted line
+    int failed;
+    int initialized;        // set if members were created
+};
+
+// pushes converted line into line vector or passes its number to error
+// callback
+static void pushLine(void *context, readStatus status, Line *line) {
+    SimilarLines *self = context;
+    ++self->nr;
+
+    if (status == READ_OK) {
+        line->nr = self->nr;
+        LineVectorPush(&self->lines, line);
+    }
+    else if (status == READ_ERROR && self->callbacks.error != NULL) {
+        self->callbacks.error(self->callbacks.user,
+                              (unsigned long long)self->nr);
+    }
+}
+
+// copies bytes into buffer piece by piece and converts them
+static void convert(SimilarLines *self, const char *data, size_t length) {
+    while (length > 0) {
+        size_t n = length < PUSH_BUFFER_SIZE ? length : PUSH_BUFFER_SIZE;
+        memcpy(self->buffer, data, n);
+        PushScannerPush(&self->scanner, self->buffer, n, pushLine, self);
+        data += n;
+        length -= n;
+    }
+}
+
+// finds groups of converted lines and passes them to group callback
+static void report(SimilarLines *self) {
+    const SimilarLinesConfig *config = &self->config;
+    ULLVectorVector groups = ULLVectorVectorNew();
+
+    if (config->grouping == SIMILAR_LINES_HASH)
+        groupByHashing(&self->lines, config->threads, &groups);
+    else if (config->grouping == SIMILAR_LINES_APPROX)
+        groupApproximately(&self->lines, config->threads, config->threshold,
+                           &groups);
+    else
+        groupBySorting(&self->lines, config->threads, &groups);
+
+    for (size_t i = 0; i < groups.size && self->callbacks.group != NULL;
+         ++i) {
+        self->callbacks.group(self->callbacks.user,
+                              ULLVectorItems(&groups.items[i]),
+                              groups.items[i].size);
+    }
+
+    ULLVectorVectorFree(&groups);
+}
+
+// creates members of context, returns 0 if allocation failed
+static int initialize(SimilarLines *self) {
+    jmp_buf recovery;
+    jmp_buf *previous = allocationRecovery;
+    if (setjmp(recovery) != 0) {
+        allocationRecovery = previous;
+        return 0;
+    }
+    allocationRecovery = &recovery;
+
+    self->buffer = malloc(PUSH_BUFFER_SIZE);
+    self->dictionary = DictionaryNew();
+    if (self->buffer == NULL || self->dictionary == NULL) {
+        allocationFailed();
+    }
+    self->lines = LineVectorNew();
+    self->scanner = PushScannerNew();
+    self->initialized = 1;
+
+    allocationRecovery = previous;
+    return 1;
+}
+
+SimilarLines *SimilarLinesNew(const SimilarLinesConfig *config,
+                              const SimilarLinesCallbacks *callbacks) {
+    SimilarLinesConfig defaults = {SIMILAR_LINES_SORT, 1, 0};
+    if (config == NULL)
+        config = &defaults;
+
+    if (config->grouping < SIMILAR_LINES_SORT ||
+        config->grouping > SIMILAR_LINES_APPROX || config->threads < 0 ||
+        !(config->threshold >= 0 && config->threshold <= 1))
+        return NULL;
+
+    SimilarLines *self = calloc(1, sizeof (SimilarLines));
+    if (self == NULL)
+        return NULL;
+
+    self->config = *config;
+    if (self->config.threads == 0)
+        self->config.threads = 1;
+    if (self->config.threshold == 0)
+        self->config.threshold = DEFAULT_APPROX_THRESHOLD;
+    if (callbacks != NULL)
+        self->callbacks = *callbacks;
+
+    if (!initialize(self)) {
+        SimilarLinesFree(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+void SimilarLinesFree(SimilarLines *self) {
+    if (self == NULL)
+        return;
+
+    free(self->buffer);
+    if (self->initialized) {
+        LineVectorFree(&self->lines);
+        PushScannerFree(&self->scanner);
+    }
+    DictionaryFree(self->dictionary);
+    free(self);
+}
+
+similarLinesStatus SimilarLinesPush(SimilarLines *self, const char *data,
+                                    size_t length) {
+    if (self->failed)
+        return SIMILAR_LINES_UNUSABLE;
+
+    jmp_buf recovery;
+    jmp_buf *previous = allocationRecovery;
+    Dictionary *dictionary = internDictionary();
+    if (setjmp(recovery) != 0) {
+        allocationRecovery = previous;
+        internUse(dictionary);
+        self->failed = 1;
+        return SIMILAR_LINES_NO_MEMORY;
+    }
+    allocationRecovery = &recovery;
+    internUse(self->dictionary);
+
+    convert(self, data, length);
+
+    allocationRecovery = previous;
+    internUse(dictionary);
+    return SIMILAR_LINES_OK;
+}
+
+similarLinesStatus SimilarLinesFinish(SimilarLines *self) {
+    if (self->failed)
+        return SIMILAR_LINES_UNUSABLE;
+
+    jmp_buf recovery;
+    jmp_buf *previous = allocationRecovery;
+    Dictionary *dictionary = internDictionary();
+    if (setjmp(recovery) != 0) {
+        allocationRecovery = previous;
+        internUse(dictionary);
+        self->failed = 1;
+        return SIMILAR_LINES_NO_MEMORY;
+    }
+    allocationRecovery = &recovery;
+    internUse(self->dictionary);
+
+    PushScannerFinish(&self->scanner, pushLine, self);
+    report(self);
+
+    LineVectorClear(&self->lines);
+    internFree();
+    self->nr = 0;
+
+    allocationRecovery = previous;
+    internUse(dictionary);
+    return SIMILAR_LINES_OK;
+}
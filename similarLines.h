@@ -0,0 +1,89 @@
+/**
+ * Summary of File:
+ *
+ *   This header is the interface of library libsimilarlines, which finds
+ *   groups of similar lines in the same way as the program, without
+ *   reading stdin or writing stdout.
+ *   Input is pushed into context in buffers of any size, lines may be
+ *   split between buffers. Numbers of incorrect lines are passed to error
+ *   callback as soon as their lines are complete. When input ends, groups
+ *   are passed to group callback in the order in which the program prints
+ *   them, then context is ready for next input, which lines are numbered
+ *   from 1 again.
+ *   Functions return error codes instead of ending the program. After
+ *   SIMILAR_LINES_NO_MEMORY context must only be freed. SimilarLinesFree
+ *   releases memory owned by context, growing buffers of context keep their
+ *   old blocks when they can't grow, but temporary memory allocated by the
+ *   interrupted function (e.g. while groups are found) is leaked.
+ *   Each context can be used by one thread at a time, separate contexts can
+ *   be used by separate threads at once. Each context has its own
+ *   dictionary of words, which is emptied when input ends, so memory of
+ *   long-lived context doesn't grow with all inputs it has seen. Callbacks
+ *   must not use their context.
+ */
+
+#ifndef SIMILAR_LINES_SIMILARLINES_H
+#define SIMILAR_LINES_SIMILARLINES_H
+
+#include <stdlib.h>
+
+#if defined(__GNUC__)
+#define SIMILAR_LINES_API __attribute__((visibility("default")))
+#else
+#define SIMILAR_LINES_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SimilarLines SimilarLines;
+
+typedef enum {
+    SIMILAR_LINES_OK,
+    SIMILAR_LINES_NO_MEMORY,
+    SIMILAR_LINES_UNUSABLE      // context failed before
+} similarLinesStatus;
+
+typedef enum {
+    SIMILAR_LINES_SORT,
+    SIMILAR_LINES_HASH,
+    SIMILAR_LINES_APPROX
+} similarLinesGrouping;
+
+typedef struct {
+    similarLinesGrouping grouping;
+    int threads;                // threads used for grouping, 0 means 1
+    double threshold;           // see approx.h, 0 means 0.8
+} SimilarLinesConfig;
+
+typedef struct {
+    // called for each group with sorted numbers of its lines, may be NULL
+    void (*group)(void *user, const unsigned long long *lines,
+                  size_t count);
+    // called with number of each incorrect line, may be NULL
+    void (*error)(void *user, unsigned long long line);
+    void *user;                 // passed to callbacks
+} SimilarLinesCallbacks;
+
+// returns new context or NULL if config is invalid or there is no memory
+// config may be NULL for default sorting by one thread
+SIMILAR_LINES_API SimilarLines *SimilarLinesNew(
+    const SimilarLinesConfig *config, const SimilarLinesCallbacks *callbacks);
+
+SIMILAR_LINES_API void SimilarLinesFree(SimilarLines *self);
+
+// adds bytes of input
+SIMILAR_LINES_API similarLinesStatus SimilarLinesPush(SimilarLines *self,
+                                                      const char *data,
+                                                      size_t length);
+
+// ends input, the last line doesn't have to end with '\n', and reports
+// groups
+SIMILAR_LINES_API similarLinesStatus SimilarLinesFinish(SimilarLines *self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SIMILAR_LINES_SIMILARLINES_H
@@ -0,0 +1,196 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements sorting of arrays of elements of lines. Most lines
+ *   have a few elements, so they are sorted by insertion sort without any
+ *   function calls. Bigger arrays are converted into unsigned keys which
+ *   have the same order as elements and sorted by LSD radix sort, byte by
+ *   byte. Bytes which are equal in all keys are skipped.
+ */
+
+#include "sort.h"
+
+#include "alloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// arrays bigger than this are sorted by radix sort
+const size_t INSERTION_SORT_LIMIT = 32;
+
+static const unsigned long long SIGN_BIT = 1ULL << 63;
+
+static void insertionSortULL(unsigned long long *items, size_t n) {
+    for (size_t i = 1; i < n; ++i) {
+        unsigned long long x = items[i];
+        size_t j = i;
+        while (j > 0 && items[j - 1] > x) {
+            items[j] = items[j - 1];
+            j--;
+        }
+        items[j] = x;
+    }
+}
+
+static void insertionSortLL(long long *items, size_t n) {
+    for (size_t i = 1; i < n; ++i) {
+        long long x = items[i];
+        size_t j = i;
+        while (j > 0 && items[j - 1] > x) {
+            items[j] = items[j - 1];
+            j--;
+        }
+        items[j] = x;
+    }
+}
+
+static void insertionSortD(double *items, size_t n) {
+    for (size_t i = 1; i < n; ++i) {
+        double x = items[i];
+        size_t j = i;
+        while (j > 0 && items[j - 1] > x) {
+            items[j] = items[j - 1];
+            j--;
+        }
+        items[j] = x;
+    }
+}
+
+static void insertionSortUInt(unsigned int *items, size_t n) {
+    for (size_t i = 1; i < n; ++i) {
+        unsigned int x = items[i];
+        size_t j = i;
+        while (j > 0 && items[j - 1] > x) {
+            items[j] = items[j - 1];
+            j--;
+        }
+        items[j] = x;
+    }
+}
+
+static unsigned long long *allocateKeys(size_t n) {
+    unsigned long long *keys = malloc(n * sizeof (unsigned long long));
+    if (keys == NULL) {
+        allocationFailed();
+    }
+    return keys;
+}
+
+// sorts keys by bytes from the least significant one
+static void radixSort(unsigned long long *keys, size_t n) {
+    static const int BYTES = sizeof (unsigned long long);
+    size_t counts[sizeof (unsigned long long)][256];
+    memset(counts, 0, sizeof counts);
+
+    for (size_t i = 0; i < n; ++i) {
+        for (int b = 0; b < BYTES; ++b) {
+            counts[b][(keys[i] >> (8 * b)) & 0xff]++;
+        }
+    }
+
+    unsigned long long *buffer = allocateKeys(n);
+    unsigned long long *src = keys;
+    unsigned long long *dst = buffer;
+
+    for (int b = 0; b < BYTES; ++b) {
+        size_t *count = counts[b];
+        int shift = 8 * b;
+
+        if (count[(src[0] >> shift) & 0xff] == n)
+            continue; // all keys have the same byte
+
+        size_t offset = 0;
+        for (int d = 0; d < 256; ++d) {
+            size_t c = count[d];
+            count[d] = offset;
+            offset += c;
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            dst[count[(src[i] >> shift) & 0xff]++] = src[i];
+        }
+
+        unsigned long long *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != keys)
+        memcpy(keys, src, n * sizeof (unsigned long long));
+
+    free(buffer);
+}
+
+void sortULLArray(unsigned long long *items, size_t n) {
+    if (n <= INSERTION_SORT_LIMIT)
+        insertionSortULL(items, n);
+    else
+        radixSort(items, n);
+}
+
+// signed numbers have the same order as unsigned numbers with flipped sign
+void sortLLArray(long long *items, size_t n) {
+    if (n <= INSERTION_SORT_LIMIT) {
+        insertionSortLL(items, n);
+        return;
+    }
+
+    unsigned long long *keys = allocateKeys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = (unsigned long long)items[i] ^ SIGN_BIT;
+    }
+
+    radixSort(keys, n);
+
+    for (size_t i = 0; i < n; ++i) {
+        items[i] = (long long)(keys[i] ^ SIGN_BIT);
+    }
+    free(keys);
+}
+
+// bits of positive doubles have the same order as their values, bits of
+// negative ones have reversed order, so all bits of negative doubles are
+// flipped and only sign of positive ones
+// there are no NaNs in lines
+void sortDArray(double *items, size_t n) {
+    if (n <= INSERTION_SORT_LIMIT) {
+        insertionSortD(items, n);
+        return;
+    }
+
+    unsigned long long *keys = allocateKeys(n);
+    for (size_t i = 0; i < n; ++i) {
+        unsigned long long bits;
+        memcpy(&bits, &items[i], sizeof bits);
+        keys[i] = (bits & SIGN_BIT) ? ~bits : bits ^ SIGN_BIT;
+    }
+
+    radixSort(keys, n);
+
+    for (size_t i = 0; i < n; ++i) {
+        unsigned long long bits = (keys[i] & SIGN_BIT) ? keys[i] ^ SIGN_BIT
+                                                       : ~keys[i];
+        memcpy(&items[i], &bits, sizeof bits);
+    }
+    free(keys);
+}
+
+// high bytes of keys are zero, so radix sort skips them
+void sortUIntArray(unsigned int *items, size_t n) {
+    if (n <= INSERTION_SORT_LIMIT) {
+        insertionSortUInt(items, n);
+        return;
+    }
+
+    unsigned long long *keys = allocateKeys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = items[i];
+    }
+
+    radixSort(keys, n);
+
+    for (size_t i = 0; i < n; ++i) {
+        items[i] = (unsigned int)keys[i];
+    }
+    free(keys);
+}
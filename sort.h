@@ -0,0 +1,18 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides ascending sort of arrays of elements of lines.
+ *   Small arrays are sorted by insertion sort, big ones by radix sort.
+ */
+
+#ifndef SIMILAR_LINES_SORT_H
+#define SIMILAR_LINES_SORT_H
+
+#include <stdlib.h>
+
+void sortULLArray(unsigned long long *items, size_t n);
+void sortLLArray(long long *items, size_t n);
+void sortDArray(double *items, size_t n);
+void sortUIntArray(unsigned int *items, size_t n);
+
+#endif //SIMILAR_LINES_SORT_H
@@ -0,0 +1,157 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements statistics described in related header. Counters
+ *   which may be changed by many threads are atomic, relaxed order is
+ *   enough, because they are read after threads are joined.
+ */
+
+#include "stats.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#define MAX_PHASES 16
+
+typedef struct {
+    const char *name;
+    double wall;
+    double cpu;
+} Phase;
+
+int statsEnabled = 0;
+
+static const char *reportFile = NULL;
+static pthread_t owner;             // thread which started statistics
+
+static Phase phases[MAX_PHASES];
+static int phaseCount = 0;
+static int current = -1;            // index of current phase
+static double phaseWall = 0;        // when current phase started
+static double phaseCpu = 0;
+
+static atomic_ullong lineCounts[sizeof (LineCounts) /
+                                sizeof (unsigned long long)];
+static atomic_ullong allocations[ALLOCATION_KINDS];
+static atomic_ullong allocatedBytes[ALLOCATION_KINDS];
+
+static const char *ALLOCATION_NAMES[ALLOCATION_KINDS] = {"vector", "arena"};
+
+// returns time of given clock in seconds
+static double seconds(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void statsStart(const char *file) {
+    statsEnabled = 1;
+    reportFile = file;
+    owner = pthread_self();
+}
+
+// adds time from start of current phase to it
+static void endPhase(void) {
+    double wall = seconds(CLOCK_MONOTONIC);
+    double cpu = seconds(CLOCK_PROCESS_CPUTIME_ID);
+
+    if (current >= 0) {
+        phases[current].wall += wall - phaseWall;
+        phases[current].cpu += cpu - phaseCpu;
+    }
+
+    phaseWall = wall;
+    phaseCpu = cpu;
+}
+
+void statsPhase(const char *name) {
+    if (!statsEnabled || !pthread_equal(pthread_self(), owner))
+        return;
+
+    endPhase();
+
+    for (current = 0; current < phaseCount; ++current) {
+        if (strcmp(phases[current].name, name) == 0)
+            return;
+    }
+
+    if (phaseCount == MAX_PHASES) {
+        current = -1;
+        return;
+    }
+
+    Phase phase = {name, 0, 0};
+    phases[phaseCount] = phase;
+    current = phaseCount++;
+}
+
+void statsAddLines(const LineCounts *counts) {
+    if (!statsEnabled)
+        return;
+
+    const unsigned long long *c = (const unsigned long long *)counts;
+    for (size_t i = 0; i < sizeof lineCounts / sizeof lineCounts[0]; ++i) {
+        atomic_fetch_add_explicit(&lineCounts[i], c[i],
+                                  memory_order_relaxed);
+    }
+}
+
+void statsCountAllocation(allocationKind kind, size_t bytes) {
+    atomic_fetch_add_explicit(&allocations[kind], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&allocatedBytes[kind], bytes,
+                              memory_order_relaxed);
+}
+
+void statsReport(void) {
+    if (!statsEnabled)
+        return;
+
+    endPhase();
+    current = -1;
+
+    FILE *out = stderr;
+    if (reportFile != NULL) {
+        out = fopen(reportFile, "w");
+        if (out == NULL) {
+            perror(reportFile);
+            out = stderr;
+        }
+    }
+
+    for (int i = 0; i < phaseCount; ++i) {
+        fprintf(out, "phase %s wall %.6f cpu %.6f\n", phases[i].name,
+                phases[i].wall, phases[i].cpu);
+    }
+
+    LineCounts counts;
+    unsigned long long *c = (unsigned long long *)&counts;
+    for (size_t i = 0; i < sizeof lineCounts / sizeof lineCounts[0]; ++i) {
+        c[i] = atomic_load_explicit(&lineCounts[i], memory_order_relaxed);
+    }
+
+    fprintf(out, "lines total %llu correct %llu error %llu comment %llu "
+                 "empty %llu\n",
+            counts.correct + counts.errors + counts.comments + counts.empty,
+            counts.correct, counts.errors, counts.comments, counts.empty);
+    fprintf(out, "tokens ull %llu ll %llu double %llu string %llu\n",
+            counts.ullTokens, counts.llTokens, counts.dTokens,
+            counts.sTokens);
+
+    for (int i = 0; i < ALLOCATION_KINDS; ++i) {
+        fprintf(out, "allocations %s %llu bytes %llu\n", ALLOCATION_NAMES[i],
+                atomic_load_explicit(&allocations[i], memory_order_relaxed),
+                atomic_load_explicit(&allocatedBytes[i],
+                                     memory_order_relaxed));
+    }
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        fprintf(out, "peak_rss_kib %ld\n", usage.ru_maxrss);
+
+    if (out != stderr)
+        fclose(out);
+}
@@ -0,0 +1,61 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides statistics of a run, which are collected only if
+ *   option "--stats" was given: wall and CPU time of each phase, numbers of
+ *   lines and tokens of each type, allocations of vectors and arenas and
+ *   peak resident set size. Report is printed at the end of the run.
+ *   When statistics are disabled, each function returns after one check of
+ *   a flag, so hot paths are not slowed down.
+ */
+
+#ifndef SIMILAR_LINES_STATS_H
+#define SIMILAR_LINES_STATS_H
+
+#include <stdlib.h>
+
+typedef enum {
+    ALLOCATION_VECTOR,
+    ALLOCATION_ARENA,
+    ALLOCATION_KINDS
+} allocationKind;
+
+// counted by line scanner
+typedef struct {
+    unsigned long long correct;
+    unsigned long long errors;
+    unsigned long long comments;
+    unsigned long long empty;
+    unsigned long long ullTokens;
+    unsigned long long llTokens;
+    unsigned long long dTokens;
+    unsigned long long sTokens;
+} LineCounts;
+
+extern int statsEnabled;
+
+// enables statistics, report is written to given file or to stderr if
+// file is NULL
+void statsStart(const char *file);
+
+// ends current phase and starts phase of given name, time of phases with
+// the same name is summed
+// calls from other threads than the one which started statistics are
+// ignored, so work done by many threads at once is one phase
+void statsPhase(const char *name);
+
+// adds counts of lines, it's safe to call from many threads
+void statsAddLines(const LineCounts *counts);
+
+void statsCountAllocation(allocationKind kind, size_t bytes);
+
+// counts allocation of given size, it's safe to call from many threads
+static inline void statsAllocation(allocationKind kind, size_t bytes) {
+    if (statsEnabled)
+        statsCountAllocation(kind, bytes);
+}
+
+// ends current phase and writes report
+void statsReport(void);
+
+#endif //SIMILAR_LINES_STATS_H
@@ -0,0 +1,463 @@
+/**
+ * Summary of File:
+ *
+ *   This file implements streaming mode. Each correct line is converted
+ *   into one reused line and its key (see line.h) is looked up in hash table
+ *   of classes. Class owns copy of the key and queue of numbers of its lines.
+ *   When window is set, all kept lines are also in one queue in input order,
+ *   so the oldest line is always at the front of both queues and it can be
+ *   removed in constant time. Empty classes are removed from table.
+ *   With window, keys of classes contain words themselves instead of their
+ *   ids (see compare.h), so dictionary of words can be cleared when it grows
+ *   too big and words of forgotten lines don't stay in memory.
+ *   Diagnostics go through writer, which retries writes interrupted by
+ *   signals requesting snapshots.
+ */
+
+#include "stream.h"
+
+#include "alloc.h"
+#include "compare.h"
+#include "fingerprint.h"
+#include "intern.h"
+#include "line.h"
+#include "options.h"
+#include "output.h"
+#include "parse.h"
+#include "reader.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+const size_t INITIAL_QUEUE_SIZE = 4;
+const size_t INITIAL_CLASS_TABLE_SIZE = 1024;
+
+// with window dictionary is cleared when it uses more bytes
+const size_t MAX_WINDOW_DICTIONARY = 16 << 20;
+
+// queue of line numbers in cyclic buffer
+typedef struct {
+    unsigned long long *items;
+    size_t first;
+    size_t size;
+    size_t allocated;
+} Queue;
+
+typedef struct {
+    unsigned char *key;
+    size_t keyLength;
+    unsigned long long hash;
+    Queue lines;
+} StreamClass;
+
+// kept line in order of input
+typedef struct {
+    StreamClass *c;
+    unsigned long long nr;
+    double time;
+} KeptLine;
+
+typedef struct {
+    KeptLine *items;
+    size_t first;
+    size_t size;
+    size_t allocated;
+} KeptLineQueue;
+
+typedef struct {
+    StreamClass **slots;    // hash table with open addressing
+    size_t capacity;
+    size_t size;
+    KeptLineQueue kept;     // used only with window
+    unsigned long long lastNr;
+    int printed;            // 1 if groups were already printed
+    Writer output;
+    Writer errors;
+} Stream;
+
+static volatile sig_atomic_t snapshotRequested = 0;
+
+static void requestSnapshot(int signal) {
+    (void)signal;
+    snapshotRequested = 1;
+}
+
+// returns time in seconds from some fixed moment
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void QueuePush(Queue *self, unsigned long long x) {
+    if (self->size == self->allocated) {
+        size_t allocated = self->allocated == 0 ? INITIAL_QUEUE_SIZE
+                                                : self->allocated * 2;
+        unsigned long long *items = malloc(allocated * sizeof x);
+        if (items == NULL) {
+            allocationFailed();
+        }
+        for (size_t i = 0; i < self->size; ++i) {
+            items[i] = self->items[(self->first + i) % self->allocated];
+        }
+        free(self->items);
+        self->items = items;
+        self->first = 0;
+        self->allocated = allocated;
+    }
+
+    self->items[(self->first + self->size++) % self->allocated] = x;
+}
+
+static unsigned long long QueueGet(const Queue *self, size_t i) {
+    return self->items[(self->first + i) % self->allocated];
+}
+
+static void QueuePop(Queue *self) {
+    self->first = (self->first + 1) % self->allocated;
+    self->size--;
+}
+
+static void KeptLineQueuePush(KeptLineQueue *self, KeptLine x) {
+    if (self->size == self->allocated) {
+        size_t allocated = self->allocated == 0 ? INITIAL_QUEUE_SIZE
+                                                : self->allocated * 2;
+        KeptLine *items = malloc(allocated * sizeof x);
+        if (items == NULL) {
+            allocationFailed();
+        }
+        for (size_t i = 0; i < self->size; ++i) {
+            items[i] = self->items[(self->first + i) % self->allocated];
+        }
+        free(self->items);
+        self->items = items;
+        self->first = 0;
+        self->allocated = allocated;
+    }
+
+    self->items[(self->first + self->size++) % self->allocated] = x;
+}
+
+static Stream StreamNew() {
+    Stream obj = {NULL, INITIAL_CLASS_TABLE_SIZE, 0, {NULL, 0, 0, 0}, 0, 0,
+                  WriterNew(fileno(stdout)), WriterNew(fileno(stderr))};
+
+    obj.slots = calloc(obj.capacity, sizeof (StreamClass *));
+    if (obj.slots == NULL) {
+        allocationFailed();
+    }
+
+    return obj;
+}
+
+static void StreamClassFree(StreamClass *c) {
+    free(c->key);
+    free(c->lines.items);
+    free(c);
+}
+
+static void StreamFree(Stream *self) {
+    for (size_t i = 0; i < self->capacity; ++i) {
+        if (self->slots[i] != NULL)
+            StreamClassFree(self->slots[i]);
+    }
+    free(self->slots);
+    free(self->kept.items);
+    WriterFree(&self->output);
+    WriterFree(&self->errors);
+}
+
+static void putIntoSlot(StreamClass **slots, size_t capacity, StreamClass *c) {
+    size_t j = c->hash & (capacity - 1);
+    while (slots[j] != NULL) {
+        j = (j + 1) & (capacity - 1);
+    }
+    slots[j] = c;
+}
+
+static void StreamGrow(Stream *self) {
+    size_t capacity = self->capacity * 2;
+    StreamClass **slots = calloc(capacity, sizeof (StreamClass *));
+    if (slots == NULL) {
+        allocationFailed();
+    }
+
+    for (size_t i = 0; i < self->capacity; ++i) {
+        if (self->slots[i] != NULL)
+            putIntoSlot(slots, capacity, self->slots[i]);
+    }
+
+    free(self->slots);
+    self->slots = slots;
+    self->capacity = capacity;
+}
+
+// removes class from table, classes behind it are moved back, so there are
+// no gaps in their probe sequences
+static void StreamRemove(Stream *self, StreamClass *c) {
+    size_t mask = self->capacity - 1;
+    size_t j = c->hash & mask;
+    while (self->slots[j] != c) {
+        j = (j + 1) & mask;
+    }
+
+    size_t k = j;
+    while (1) {
+        k = (k + 1) & mask;
+        if (self->slots[k] == NULL)
+            break;
+        // slot k can be moved into j if its home isn't in (j, k]
+        size_t home = self->slots[k]->hash & mask;
+        if (((k - home) & mask) >= ((k - j) & mask)) {
+            self->slots[j] = self->slots[k];
+            j = k;
+        }
+    }
+    self->slots[j] = NULL;
+    self->size--;
+
+    StreamClassFree(c);
+}
+
+// adds line with given key to its class
+// returns class of line
+static StreamClass *StreamInsert(Stream *self, const unsigned char *key,
+                                 size_t keyLength, unsigned long long nr) {
+    unsigned long long hash = hashBytes((const char *)key, keyLength);
+    size_t mask = self->capacity - 1;
+    size_t j = hash & mask;
+
+    while (self->slots[j] != NULL) {
+        StreamClass *c = self->slots[j];
+        if (c->hash == hash && c->keyLength == keyLength &&
+            memcmp(c->key, key, keyLength) == 0) {
+            QueuePush(&c->lines, nr);
+            return c;
+        }
+        j = (j + 1) & mask;
+    }
+
+    StreamClass *c = malloc(sizeof (StreamClass));
+    unsigned char *copy = malloc(keyLength);
+    if (c == NULL || copy == NULL) {
+        allocationFailed();
+    }
+    memcpy(copy, key, keyLength);
+
+    StreamClass obj = {copy, keyLength, hash, {NULL, 0, 0, 0}};
+    *c = obj;
+    QueuePush(&c->lines, nr);
+    self->slots[j] = c;
+    self->size++;
+
+    // keep load factor at most 1/2
+    if (2 * self->size > self->capacity)
+        StreamGrow(self);
+
+    return c;
+}
+
+// forgets the oldest kept line
+static void StreamForget(Stream *self) {
+    StreamClass *c = self->kept.items[self->kept.first].c;
+    self->kept.first = (self->kept.first + 1) % self->kept.allocated;
+    self->kept.size--;
+
+    QueuePop(&c->lines);
+    if (c->lines.size == 0)
+        StreamRemove(self, c);
+}
+
+// forgets lines which are outside window
+static void StreamForgetOld(Stream *self, const Options *options) {
+    if (options->windowLines > 0) {
+        while (self->kept.size > 0 &&
+               self->kept.items[self->kept.first].nr + options->windowLines <=
+               self->lastNr) {
+            StreamForget(self);
+        }
+    }
+    if (options->windowSeconds > 0) {
+        double oldest = now() - options->windowSeconds;
+        while (self->kept.size > 0 &&
+               self->kept.items[self->kept.first].time < oldest) {
+            StreamForget(self);
+        }
+    }
+}
+
+static int cmpFirstLines(const void *a, const void *b) {
+    unsigned long long x = QueueGet(&(*(StreamClass * const *)a)->lines, 0);
+    unsigned long long y = QueueGet(&(*(StreamClass * const *)b)->lines, 0);
+
+    if (x > y) return 1;
+    if (x < y) return -1;
+    return 0;
+}
+
+// prints current groups ordered by their first lines
+static void StreamPrint(Stream *self) {
+    StreamClass **classes = malloc((self->size + 1) * sizeof (StreamClass *));
+    if (classes == NULL) {
+        allocationFailed();
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < self->capacity; ++i) {
+        if (self->slots[i] != NULL)
+            classes[n++] = self->slots[i];
+    }
+    qsort(classes, n, sizeof (StreamClass *), cmpFirstLines);
+
+    if (self->printed)
+        WriterChar(&self->output, '\n');
+    self->printed = 1;
+
+    for (size_t i = 0; i < n; ++i) {
+        Queue *lines = &classes[i]->lines;
+        // in order to not print space at end of line
+        WriterNumber(&self->output, QueueGet(lines, 0));
+        for (size_t j = 1; j < lines->size; ++j) {
+            WriterChar(&self->output, ' ');
+            WriterNumber(&self->output, QueueGet(lines, j));
+        }
+        WriterChar(&self->output, '\n');
+    }
+    WriterFlush(&self->output);
+
+    free(classes);
+}
+
+// writes key of converted line into buffer, returns its length
+static size_t writeKey(Line *line, int window, KeyBuffer *keys) {
+    // words of forgotten lines can be freed only if keys don't use ids
+    if (window)
+        return writeContentKey(line, keys);
+
+    size_t keyLength = LineKeyLength(line);
+    if (keyLength > keys->allocated) {
+        free(keys->key);
+        keys->key = malloc(keyLength);
+        if (keys->key == NULL) {
+            allocationFailed();
+        }
+        keys->allocated = keyLength;
+    }
+    LineWriteKey(line, keys->key);
+
+    return keyLength;
+}
+
+// groups lines of block, line and keys are buffers for converted line
+static void StreamBlock(Stream *self, const Options *options, char *block,
+                        size_t length, LineScanner *scanner, Line *line,
+                        KeyBuffer *keys) {
+    int window = options->windowLines > 0 || options->windowSeconds > 0;
+    readStatus status;
+
+    LineScannerReset(scanner, block, length);
+
+    while ((status = LineScannerNext(scanner, line)) != READ_END) {
+        unsigned long long nr = ++self->lastNr;
+
+        switch (status) {
+            case READ_OK: {
+                sortElementsOfLine(line);
+                size_t keyLength = writeKey(line, window, keys);
+                LineClear(line);
+
+                StreamClass *c = StreamInsert(self, keys->key, keyLength, nr);
+                if (window) {
+                    KeptLine kept = {c, nr, options->windowSeconds > 0 ? now()
+                                                                       : 0};
+                    KeptLineQueuePush(&self->kept, kept);
+                    StreamForgetOld(self, options);
+                    if (internMemory() > MAX_WINDOW_DICTIONARY)
+                        internFree();
+                }
+                break;
+            }
+            case READ_ERROR:
+                WriterBytes(&self->errors, "ERROR ", 6);
+                WriterNumber(&self->errors, nr);
+                WriterChar(&self->errors, '\n');
+                break;
+            case READ_EMPTY_LINE:
+            case READ_COMMENT:
+            case READ_END:
+                break;
+        }
+
+        if (snapshotRequested) {
+            snapshotRequested = 0;
+            StreamForgetOld(self, options);
+            StreamPrint(self);
+        }
+    }
+}
+
+// sets handlers of signals which request printing groups, they interrupt
+// waiting for input
+static void setSignals(const Options *options) {
+    struct sigaction action;
+    memset(&action, 0, sizeof action);
+    action.sa_handler = requestSnapshot;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, NULL);
+
+    if (options->snapshotInterval > 0) {
+        sigaction(SIGALRM, &action, NULL);
+
+        struct itimerval timer;
+        timer.it_interval.tv_sec = (time_t)options->snapshotInterval;
+        timer.it_interval.tv_usec =
+            (suseconds_t)((options->snapshotInterval -
+                           (double)timer.it_interval.tv_sec) * 1e6);
+        if (timer.it_interval.tv_sec == 0 && timer.it_interval.tv_usec == 0)
+            timer.it_interval.tv_usec = 1;
+        timer.it_value = timer.it_interval;
+        setitimer(ITIMER_REAL, &timer, NULL);
+    }
+}
+
+void findSimilarInStream(const Options *options) {
+    Stream stream = StreamNew();
+    Reader reader = ReaderNew(fileno(stdin));
+    LineScanner scanner = LineScannerNew();
+    Line *line = LineNew(0);
+    KeyBuffer keys = KeyBufferNew();
+    char *block = NULL;
+    size_t length = 0;
+    int status;
+
+    reader.interruptible = 1;
+    setSignals(options);
+
+    while ((status = ReaderNextBlock(&reader, &block, &length)) != 0) {
+        if (status > 0) {
+            StreamBlock(&stream, options, block, length, &scanner, line,
+                        &keys);
+            WriterFlush(&stream.errors);
+        }
+        else if (snapshotRequested) {
+            snapshotRequested = 0;
+            StreamForgetOld(&stream, options);
+            StreamPrint(&stream);
+        }
+    }
+
+    StreamForgetOld(&stream, options);
+    StreamPrint(&stream);
+
+    KeyBufferFree(&keys);
+    LineFree(line);
+    free(line);
+    statsAddLines(&scanner.counts);
+    LineScannerFree(&scanner);
+    ReaderFree(&reader);
+    StreamFree(&stream);
+}
@@ -0,0 +1,20 @@
+/**
+ * Summary of File:
+ *
+ *   This header provides streaming mode. Lines are grouped while they are
+ *   read, so groups can be printed at any moment of endless input:
+ *   periodically, after signal SIGUSR1 and at the end of input. Printed
+ *   groups have the same format as in normal mode, groups printed at
+ *   different moments are separated by an empty line.
+ *   Optionally only last lines are kept, older lines are forgotten.
+ */
+
+#ifndef SIMILAR_LINES_STREAM_H
+#define SIMILAR_LINES_STREAM_H
+
+#include "options.h"
+
+// reads stdin and prints groups of similar lines as described above
+void findSimilarInStream(const Options *options);
+
+#endif //SIMILAR_LINES_STREAM_H
@@ -1,85 +1,138 @@
-/**
- * Author:  Mateusz Malinowski
- * Date:    March 2021
- *
- * Summary of File:
- *
- *   This header provides vector structure of following types:
- *    -char
- *    -unsigned long long
- *    -long long
- *    -double
- *    -string
- *    -unsigned long long vector
- *   and foreach following operations
- *    -new
- *    -push
- *    -free
- */
-
-#ifndef SIMILAR_LINES_VECTOR_H
-#define SIMILAR_LINES_VECTOR_H
-
-#include <stdlib.h>
-
-typedef struct {
-    char *items;
-    size_t size;
-    size_t allocated;
-} CVector;
-
-typedef struct {
-    unsigned long long *items;
-    size_t size;
-    size_t allocated;
-} ULLVector;
-
-typedef struct {
-    long long *items;
-    size_t size;
-    size_t allocated;
-} LLVector;
-
-typedef struct {
-    double *items;
-    size_t size;
-    size_t allocated;
-} DVector;
-
-typedef struct {
-    char **items;       // strings have to end with '\0'
-    size_t size;
-    size_t allocated;
-} SVector;
-
-typedef struct {
-    ULLVector *items;
-    size_t size;
-    size_t allocated;
-} ULLVectorVector;
-
-CVector CVectorNew();
-void CVectorFree(CVector *self);
-void CVectorPush(CVector *self, char c);
-
-ULLVector ULLVectorNew();
-void ULLVectorFree(ULLVector *self);
-void ULLVectorPush(ULLVector *self, unsigned long long x);
-
-LLVector LLVectorNew();
-void LLVectorFree(LLVector *self);
-void LLVectorPush(LLVector *self, long long x);
-
-DVector DVectorNew();
-void DVectorFree(DVector *self);
-void DVectorPush(DVector *self, double x);
-
-SVector SVectorNew();
-void SVectorFree(SVector *self);
-void SVectorPush(SVector *self, char *str);
-
-ULLVectorVector ULLVectorVectorNew();
-void ULLVectorVectorFree(ULLVectorVector *self);
-void ULLVectorVectorPush(ULLVectorVector *self, ULLVector v);
-
-#endif //SIMILAR_LINES_VECTOR_H
+/**
+ * Author:  Mateusz Malinowski
+ * Date:    March 2021
+ *
+ * Summary of File:
+ *
+ *   This header provides vector structure of following types:
+ *    -char
+ *    -unsigned long long
+ *    -long long
+ *    -double
+ *    -string (stored as id of interned word)
+ *    -unsigned long long vector
+ *   and foreach following operations
+ *    -new
+ *    -push
+ *    -free
+ *   Vectors of elements of lines keep first few elements inline, so most of
+ *   lines don't need any memory outside of their structure. Inline elements
+ *   share place with pointer to heap and sizes are 32-bit, so such vector
+ *   isn't bigger than vector of other types. Their elements are accessed by
+ *   items functions, vector doesn't point to itself, so it can be copied as
+ *   any structure.
+ */
+
+#ifndef SIMILAR_LINES_VECTOR_H
+#define SIMILAR_LINES_VECTOR_H
+
+#include <stdlib.h>
+
+typedef struct {
+    char *items;
+    size_t size;
+    size_t allocated;
+} CVector;
+
+// number of bytes of elements which are stored in vector itself, elements
+// are moved to heap when they don't fit there
+#define VECTOR_INLINE_BYTES 16
+
+// vectors with inline elements have 32-bit sizes, so they can't grow
+// beyond it
+#define MAX_VECTOR_SIZE (1U << 31)
+
+#define ULL_INLINE_SIZE (VECTOR_INLINE_BYTES / sizeof (unsigned long long))
+#define LL_INLINE_SIZE (VECTOR_INLINE_BYTES / sizeof (long long))
+#define D_INLINE_SIZE (VECTOR_INLINE_BYTES / sizeof (double))
+#define S_INLINE_SIZE (VECTOR_INLINE_BYTES / sizeof (unsigned int))
+
+typedef struct {
+    union {
+        unsigned long long *heap;      // used if allocated isn't 0
+        unsigned long long local[ULL_INLINE_SIZE];
+    };
+    unsigned int size;
+    unsigned int allocated; // 0 while elements are stored inline
+} ULLVector;
+
+typedef struct {
+    union {
+        long long *heap;
+        long long local[LL_INLINE_SIZE];
+    };
+    unsigned int size;
+    unsigned int allocated; // 0 while elements are stored inline
+} LLVector;
+
+typedef struct {
+    union {
+        double *heap;
+        double local[D_INLINE_SIZE];
+    };
+    unsigned int size;
+    unsigned int allocated; // 0 while elements are stored inline
+} DVector;
+
+typedef struct {
+    union {
+        unsigned int *heap;
+        unsigned int local[S_INLINE_SIZE];
+    };
+    unsigned int size;
+    unsigned int allocated; // 0 while elements are stored inline
+} SVector;
+
+
+typedef struct {
+    ULLVector *items;
+    size_t size;
+    size_t allocated;
+} ULLVectorVector;
+
+// returns elements of vector
+static inline unsigned long long *ULLVectorItems(const ULLVector *self) {
+    return self->allocated == 0 ? (unsigned long long *)self->local
+                                : self->heap;
+}
+
+// returns elements of vector
+static inline long long *LLVectorItems(const LLVector *self) {
+    return self->allocated == 0 ? (long long *)self->local : self->heap;
+}
+
+// returns elements of vector
+static inline double *DVectorItems(const DVector *self) {
+    return self->allocated == 0 ? (double *)self->local : self->heap;
+}
+
+// returns elements of vector
+static inline unsigned int *SVectorItems(const SVector *self) {
+    return self->allocated == 0 ? (unsigned int *)self->local : self->heap;
+}
+
+CVector CVectorNew();
+void CVectorFree(CVector *self);
+void CVectorPush(CVector *self, char c);
+
+ULLVector ULLVectorNew();
+void ULLVectorFree(ULLVector *self);
+void ULLVectorPush(ULLVector *self, unsigned long long x);
+
+LLVector LLVectorNew();
+void LLVectorFree(LLVector *self);
+void LLVectorPush(LLVector *self, long long x);
+
+DVector DVectorNew();
+void DVectorFree(DVector *self);
+void DVectorPush(DVector *self, double x);
+
+SVector SVectorNew();
+void SVectorFree(SVector *self);
+void SVectorPush(SVector *self, unsigned int id);
+
+ULLVectorVector ULLVectorVectorNew();
+void ULLVectorVectorFree(ULLVectorVector *self);
+void ULLVectorVectorPush(ULLVectorVector *self, ULLVector v);
+
+#endif //SIMILAR_LINES_VECTOR_H